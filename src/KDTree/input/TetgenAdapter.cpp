@@ -1,10 +1,95 @@
 #include "TetgenAdapter.h"
 
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
+#include <limits>
+
+#include "KDTree/util/MappedFile.h"
 
 namespace kdtree {
+    namespace {
+        /**
+         * Identifies a binary mesh file.
+         */
+        constexpr std::array<char, 8> MESH_MAGIC{'K', 'D', 'M', 'E', 'S', 'H', '\0', '\0'};
+
+        /**
+         * The version of the binary mesh format, to be increased on every change of the layout.
+         */
+        constexpr uint32_t MESH_FORMAT_VERSION{1};
+
+        /**
+         * Written in the byte order of the writing machine, so that files of machines with a different byte order are rejected.
+         */
+        constexpr uint32_t MESH_BYTE_ORDER_MARK{0x01020304};
+
+        /**
+         * The header of a binary mesh file, followed by vertexCount float64 triplets and faceCount uint32 triplets.
+         */
+        struct MeshHeader {
+            std::array<char, 8> magic;
+            uint32_t version;
+            uint32_t byteOrder;
+            uint64_t vertexCount;
+            uint64_t faceCount;
+        };
+
+        using BinaryFace = std::array<uint32_t, 3>;
+
+        //the vertices are copied as a whole
+        static_assert(sizeof(Array3) == 3 * sizeof(double));
+    } // namespace
+
+    std::tuple<std::vector<Array3>, std::vector<IndexArray3>> TetgenAdapter::getPolyhedralSource() & {
+        this->readFiles();
+        return std::make_tuple(_vertices, _faces);
+    }
+
+    std::tuple<std::vector<Array3>, std::vector<IndexArray3>> TetgenAdapter::getPolyhedralSource() && {
+        this->readFiles();
+        return std::make_tuple(std::move(_vertices), std::move(_faces));
+    }
+
+    void TetgenAdapter::writeBinaryMesh(const std::string &filename, const std::vector<Array3> &vertices,
+                                        const std::vector<IndexArray3> &faces) {
+        if (vertices.size() > static_cast<size_t>(std::numeric_limits<uint32_t>::max()) + 1) {
+            throw std::invalid_argument("The polyhedron has too many vertices for 32 bit vertex indices.");
+        }
+        std::vector<BinaryFace> binaryFaces{};
+        binaryFaces.reserve(faces.size());
+        for (const IndexArray3 &face: faces) {
+            BinaryFace &binaryFace{binaryFaces.emplace_back()};
+            for (size_t i = 0; i < face.size(); ++i) {
+                if (face[i] >= vertices.size()) {
+                    throw std::invalid_argument("A face refers to the vertex " + std::to_string(face[i]) +
+                                                " which does not exist.");
+                }
+                binaryFace[i] = static_cast<uint32_t>(face[i]);
+            }
+        }
+        MeshHeader header{};
+        header.magic = MESH_MAGIC;
+        header.version = MESH_FORMAT_VERSION;
+        header.byteOrder = MESH_BYTE_ORDER_MARK;
+        header.vertexCount = vertices.size();
+        header.faceCount = faces.size();
+        std::ofstream file{filename, std::ios::binary};
+        file.write(reinterpret_cast<const char *>(&header), sizeof(MeshHeader));
+        file.write(reinterpret_cast<const char *>(vertices.data()), static_cast<std::streamsize>(vertices.size() * sizeof(Array3)));
+        file.write(reinterpret_cast<const char *>(binaryFaces.data()), static_cast<std::streamsize>(binaryFaces.size() * sizeof(BinaryFace)));
+        if (!file) {
+            throw std::runtime_error("The mesh could not be written to " + filename + ".");
+        }
+    }
+
+    void TetgenAdapter::convertToBinaryMesh(const std::vector<std::string> &fileNames, const std::string &outputFilename) {
+        const auto [vertices, faces] = TetgenAdapter{fileNames}.getPolyhedralSource();
+        writeBinaryMesh(outputFilename, vertices, faces);
+    }
 
-    std::tuple<std::vector<Array3>, std::vector<IndexArray3>> TetgenAdapter::getPolyhedralSource() {
+    void TetgenAdapter::readFiles() {
         //1. Step: Read in from files
         for (const auto &fileName: _fileNames) {
             size_t pos = fileName.find_last_of('.');
@@ -15,9 +100,6 @@ namespace kdtree {
             std::string suffix = fileName.substr(pos + 1);
             _suffixToOperation.at(suffix)(name);
         }
-
-        //2. Convert tetgenio to Polyhedron
-        return std::make_tuple(_vertices, _faces);
     }
 
     void TetgenAdapter::readNode(const std::string &filename) {
@@ -83,12 +165,53 @@ namespace kdtree {
         }
     }
 
+    void TetgenAdapter::readBinaryMesh(const std::string &filename) {
+        this->checkIntegrity(filename, 'a');
+        const util::MappedFile file{filename + ".kdmesh"};
+        MeshHeader header{};
+        if (file.size() < sizeof(MeshHeader)) {
+            throw std::runtime_error("The file " + filename + ".kdmesh is too small to contain a mesh.");
+        }
+        std::memcpy(&header, file.data(), sizeof(MeshHeader));
+        if (header.magic != MESH_MAGIC) {
+            throw std::runtime_error("The file " + filename + ".kdmesh does not contain a mesh.");
+        }
+        if (header.version != MESH_FORMAT_VERSION) {
+            throw std::runtime_error("The file " + filename + ".kdmesh has been written in version " + std::to_string(header.version) +
+                                     " of the format, expected version " + std::to_string(MESH_FORMAT_VERSION) + ".");
+        }
+        if (header.byteOrder != MESH_BYTE_ORDER_MARK) {
+            throw std::runtime_error("The file " + filename + ".kdmesh has been written on a machine with a different byte order.");
+        }
+        //the counts must match the size of the file exactly, checked without overflowing
+        const size_t payload{file.size() - sizeof(MeshHeader)};
+        if (header.vertexCount > payload / sizeof(Array3) ||
+            header.faceCount > (payload - header.vertexCount * sizeof(Array3)) / sizeof(BinaryFace) ||
+            payload != header.vertexCount * sizeof(Array3) + header.faceCount * sizeof(BinaryFace)) {
+            throw std::runtime_error("The file " + filename + ".kdmesh is truncated or malformed.");
+        }
+        const std::byte *vertexData{file.data() + sizeof(MeshHeader)};
+        const std::byte *faceData{vertexData + header.vertexCount * sizeof(Array3)};
+        _vertices.resize(header.vertexCount);
+        std::memcpy(_vertices.data(), vertexData, header.vertexCount * sizeof(Array3));
+        _faces.clear();
+        _faces.reserve(header.faceCount);
+        for (size_t i = 0; i < header.faceCount; ++i) {
+            BinaryFace binaryFace{};
+            std::memcpy(&binaryFace, faceData + i * sizeof(BinaryFace), sizeof(BinaryFace));
+            if (binaryFace[0] >= header.vertexCount || binaryFace[1] >= header.vertexCount || binaryFace[2] >= header.vertexCount) {
+                throw std::runtime_error("The file " + filename + ".kdmesh contains a face referring to a missing vertex.");
+            }
+            _faces.push_back({binaryFace[0], binaryFace[1], binaryFace[2]});
+        }
+    }
+
     void TetgenAdapter::checkIntegrity(const std::string &filename, char what) const {
-        if ((what == 'v' || what == 'a') && _tetgenio.numberofpoints != 0) {
+        if ((what == 'v' || what == 'a') && (_tetgenio.numberofpoints != 0 || !_vertices.empty())) {
             throw std::runtime_error(
                     "The Polyhedron already has well defined nodes! The information of " + filename
                     + ".node is redundant!");
-        } else if ((what == 'f' || what == 'a') && (_tetgenio.numberoftrifaces != 0 || _tetgenio.numberoffacets != 0)) {
+        } else if ((what == 'f' || what == 'a') && (_tetgenio.numberoftrifaces != 0 || _tetgenio.numberoffacets != 0 || !_faces.empty())) {
             throw std::runtime_error(
                     "The Polyhedron already has well defined faces! The information of " + filename
                     + ".node is redundant!");
@@ -70,9 +70,35 @@ namespace kdtree {
          * This functions consists of two steps. First, the Adapter will delegate I/O to the tetgen library and
          * read in the Polyhedron data in the library's datastructure. Second, tetgen's datastructure is then
          * converted to a Polyhedron.
-         * @return a Polyhedron
+         * @return a copy of the Polyhedron
          */
-        std::tuple<std::vector<Array3>, std::vector<IndexArray3>> getPolyhedralSource();
+        std::tuple<std::vector<Array3>, std::vector<IndexArray3>> getPolyhedralSource() &;
+
+        /**
+         * Overload for temporary adapters, which moves the read Polyhedron out of the adapter instead of copying it.
+         * @return the Polyhedron
+         */
+        std::tuple<std::vector<Array3>, std::vector<IndexArray3>> getPolyhedralSource() &&;
+
+        /**
+         * Writes a Polyhedron in the binary .kdmesh format, which is read by mapping it into memory instead of parsing text.
+         * The file consists of a header, the vertex coordinates as float64 triplets and the faces as uint32 triplets, in the byte order of the writing machine.
+         * @param filename The path of the file to write, including the suffix
+         * @param vertices The vertex coordinates of the polyhedron
+         * @param faces The faces of the polyhedron
+         * @throws std::invalid_argument if a face refers to a missing vertex or the vertex indices exceed 32 bit
+         * @throws std::runtime_error if the file cannot be written
+         */
+        static void writeBinaryMesh(const std::string &filename, const std::vector<Array3> &vertices,
+                                    const std::vector<IndexArray3> &faces);
+
+        /**
+         * Converts a Polyhedron given in any of the supported formats into the binary .kdmesh format.
+         * @param fileNames The files containing the polyhedron, e.g. a .node and a .face file
+         * @param outputFilename The path of the .kdmesh file to write
+         * @throws std::runtime_error if the input cannot be read or the output cannot be written
+         */
+        static void convertToBinaryMesh(const std::vector<std::string> &fileNames, const std::string &outputFilename);
 
         /**
          * Reads nodes from a .node file
@@ -116,6 +142,12 @@ namespace kdtree {
          */
         void readMesh(const std::string &filename);
 
+        /**
+         * Reads elements from a .kdmesh file (binary format written by {@link writeBinaryMesh})
+         * @param filename of the input source without suffix
+         * @throws an exception if the elements already have been defined or the file is malformed
+         */
+        void readBinaryMesh(const std::string &filename);
 
     private:
 
@@ -129,9 +161,15 @@ namespace kdtree {
                 {"off",  [this](const std::string &name) { this->readOff(name); }},
                 {"ply",  [this](const std::string &name) { this->readPly(name); }},
                 {"stl",  [this](const std::string &name) { this->readStl(name); }},
-                {"mesh", [this](const std::string &name) { this->readMesh(name); }}
+                {"mesh", [this](const std::string &name) { this->readMesh(name); }},
+                {"kdmesh", [this](const std::string &name) { this->readBinaryMesh(name); }}
         };
 
+        /**
+         * Reads in the polyhedron from the files by delegating to the operation matching each file suffix.
+         */
+        void readFiles();
+
         /**
          * Checks if the polyhedron is integer and not already defined by other properties
          * @param filename string with the current read file, for more detailed exceptions
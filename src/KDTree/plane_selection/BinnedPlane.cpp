@@ -0,0 +1,136 @@
+#include "KDTree/plane_selection/BinnedPlane.h"
+
+namespace kdtree {
+    // O(N) implementation
+    std::tuple<Plane, double, std::variant<TriangleIndexVectors<2>, PlaneEventVectors<2> > > BinnedPlane::findPlane(
+        const SplitParam &splitParam) {
+        if (std::holds_alternative<PlaneEventVector>(splitParam.boundFaces)) {
+            throw std::invalid_argument("BinnedPlane does not support PlaneEventLists in SplitParam argument");
+        }
+        const auto &boundFaces = std::get<TriangleIndexVector>(splitParam.boundFaces);
+        const Box &boundingBox{splitParam.boundingBox};
+        //clip the faces to the bounding box once, their bounding boxes are used for binning and for the final split
+        std::vector<Box> clippedBoxes(boundFaces.size());
+        thrust::for_each(thrust::device, thrust::counting_iterator<size_t>(0),
+                         thrust::counting_iterator<size_t>(boundFaces.size()),
+                         [&splitParam, &boundFaces, &clippedBoxes](const size_t index) {
+                             constexpr double inf{std::numeric_limits<double>::infinity()};
+                             const IndexArray3 &face{splitParam.faces[boundFaces[index]]};
+                             //faces not overlapping the box get an inverted box, so that they are neither counted in a bin nor on any side of a plane
+                             clippedBoxes[index] = splitParam.boundingBox.clipToVoxelBounds(
+                                 {splitParam.vertices[face[0]], splitParam.vertices[face[1]], splitParam.vertices[face[2]]}).value_or(
+                                 Box{std::make_pair(Array3{inf, inf, inf}, Array3{-inf, -inf, -inf})});
+                         });
+
+        Array3 binWidth{};
+        for (size_t axis = 0; axis < DIMENSIONS; ++axis) {
+            binWidth[axis] = (boundingBox.maxPoint[axis] - boundingBox.minPoint[axis]) / static_cast<double>(BINS);
+        }
+        //every chunk of faces fills its own histogram, so no synchronization is needed. The histograms are summed up afterward.
+        const size_t chunkCount{std::max<size_t>(1, boundFaces.size() / CHUNK_SIZE)};
+        std::vector<Histogram> chunkHistograms(chunkCount);
+        thrust::for_each(thrust::device, thrust::counting_iterator<size_t>(0),
+                         thrust::counting_iterator<size_t>(chunkCount),
+                         [&boundingBox, &clippedBoxes, &binWidth, &chunkHistograms, chunkCount](const size_t chunk) {
+                             Histogram &histogram{chunkHistograms[chunk]};
+                             const size_t end{chunk + 1 == chunkCount ? clippedBoxes.size() : (chunk + 1) * CHUNK_SIZE};
+                             for (size_t index = chunk * CHUNK_SIZE; index < end; ++index) {
+                                 const Box &box{clippedBoxes[index]};
+                                 for (size_t axis = 0; axis < DIMENSIONS; ++axis) {
+                                     if (box.minPoint[axis] > box.maxPoint[axis] || binWidth[axis] <= 0.0) {
+                                         continue;
+                                     }
+                                     ++histogram.starts[axis][binIndex(box.minPoint[axis], boundingBox.minPoint[axis], binWidth[axis])];
+                                     ++histogram.ends[axis][binIndex(box.maxPoint[axis], boundingBox.minPoint[axis], binWidth[axis])];
+                                 }
+                             }
+                         });
+        Histogram histogram{};
+        for (const Histogram &chunkHistogram: chunkHistograms) {
+            for (size_t axis = 0; axis < DIMENSIONS; ++axis) {
+                for (size_t bin = 0; bin < BINS; ++bin) {
+                    histogram.starts[axis][bin] += chunkHistogram.starts[axis][bin];
+                    histogram.ends[axis][bin] += chunkHistogram.ends[axis][bin];
+                }
+            }
+        }
+
+        //initialize the default plane and make it costly
+        double cost = std::numeric_limits<double>::infinity();
+        Plane optPlane{0, splitParam.splitDirection};
+        //sweep over the bin borders of each dimension: faces starting left of the border overlap the lesser box, faces ending right of it the greater box
+        for (size_t axis = 0; axis < DIMENSIONS; ++axis) {
+            if (binWidth[axis] <= 0.0) {
+                continue;
+            }
+            size_t trianglesMin{0};
+            size_t trianglesMax{std::accumulate(histogram.ends[axis].cbegin(), histogram.ends[axis].cend(), size_t{0})};
+            for (size_t border = 1; border < BINS; ++border) {
+                trianglesMin += histogram.starts[axis][border - 1];
+                trianglesMax -= histogram.ends[axis][border - 1];
+                const Plane candidatePlane{
+                    boundingBox.minPoint[axis] + binWidth[axis] * static_cast<double>(border), static_cast<Direction>(axis)
+                };
+                const double candidateCost{costForPlane(boundingBox, candidatePlane, trianglesMin, trianglesMax, 0,
+                                                          splitParam.options).first};
+                //strict comparison -> on equal cost the plane with the lower dimension and coordinate is kept to build deterministic trees
+                if (candidateCost < cost) {
+                    cost = candidateCost;
+                    optPlane = candidatePlane;
+                }
+            }
+        }
+        if (std::isinf(cost)) {
+            return std::make_tuple(optPlane, cost, TriangleIndexVectors<2>{
+                                       std::make_unique<TriangleIndexVector>(splitParam.arena.get()),
+                                       std::make_unique<TriangleIndexVector>(splitParam.arena.get())
+                                   });
+        }
+        //split the faces exactly and evaluate the chosen plane with the exact counts
+        auto triangleIndexLists = containedTriangles(boundFaces, clippedBoxes, optPlane);
+        const auto [exactCost, minSideChosen] = costForPlane(boundingBox, optPlane, triangleIndexLists[0]->size(),
+                                                             triangleIndexLists[1]->size(), triangleIndexLists[2]->size(),
+                                                             splitParam.options);
+        //planar faces have to be included in one of the two sub boxes.
+        const auto &includePlanarTo = triangleIndexLists[minSideChosen ? 0 : 1];
+        includePlanarTo->insert(includePlanarTo->cend(), triangleIndexLists[2]->cbegin(), triangleIndexLists[2]->cend());
+        return std::make_tuple(optPlane, exactCost,
+                               TriangleIndexVectors<2>{std::move(triangleIndexLists[0]), std::move(triangleIndexLists[1])});
+    }
+
+    size_t BinnedPlane::binIndex(const double coordinate, const double min, const double width) {
+        const double bin{std::floor((coordinate - min) / width)};
+        return static_cast<size_t>(std::clamp(bin, 0.0, static_cast<double>(BINS - 1)));
+    }
+
+    TriangleIndexVectors<3> BinnedPlane::containedTriangles(const TriangleIndexVector &boundFaces,
+                                                            const std::vector<Box> &clippedBoxes, const Plane &plane) {
+        const auto axis = static_cast<size_t>(plane.orientation);
+        //define three sets of triangles: closer to the origin, further away, in the plane
+        auto index_less = std::make_unique<TriangleIndexVector>(boundFaces.get_allocator());
+        auto index_greater = std::make_unique<TriangleIndexVector>(boundFaces.get_allocator());
+        auto index_equal = std::make_unique<TriangleIndexVector>(boundFaces.get_allocator());
+        index_less->reserve(boundFaces.size() / 2);
+        index_greater->reserve(boundFaces.size() / 2);
+        for (size_t index = 0; index < boundFaces.size(); ++index) {
+            //the face does not overlap the box -> it is passed to neither child
+            if (clippedBoxes[index].minPoint[axis] > clippedBoxes[index].maxPoint[axis]) {
+                continue;
+            }
+            //a vertex of the clipped face lies closer to the origin than the plane, resp. further away
+            const bool less{clippedBoxes[index].minPoint[axis] < plane.axisCoordinate};
+            const bool greater{clippedBoxes[index].maxPoint[axis] > plane.axisCoordinate};
+            if (less) {
+                index_less->push_back(boundFaces[index]);
+            }
+            if (greater) {
+                index_greater->push_back(boundFaces[index]);
+            }
+            //all vertices of the triangle lie in the plane -> triangle lies in the plane
+            if (!less && !greater) {
+                index_equal->push_back(boundFaces[index]);
+            }
+        }
+        return std::array{std::move(index_less), std::move(index_greater), std::move(index_equal)};
+    }
+} // namespace kdtree
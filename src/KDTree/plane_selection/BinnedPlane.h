@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "KDTree/tree/KdDefinitions.h"
+#include "KDTree/tree/SplitParam.h"
+#include "KDTree/plane_selection/PlaneSelectionAlgorithm.h"
+#include "thrust/detail/execution_policy.h"
+#include "thrust/execution_policy.h"
+#include "thrust/iterator/counting_iterator.h"
+#include "thrust/system/detail/sequential/for_each.h"
+
+namespace kdtree {
+struct SplitParam;
+
+    /**
+     * O(N) implementation to finding split planes. The cost function is only evaluated at the borders of a fixed number of equally sized bins per dimension, which approximates the optimal plane without sorting.
+     */
+    class BinnedPlane final : public PlaneSelectionAlgorithm {
+    public:
+        /**
+         * The number of bins each dimension of a bounding box is divided into.
+         */
+        constexpr static size_t BINS{32};
+
+        /**
+        * Finds an approximately optimal split plane to split a provided rectangle section.
+        * @param splitParam specifies the polyhedron section to be split @link SplitParam.
+        * @return Tuple of the optimal plane to split the specified bounding box, its cost as double and a list of triangle sets with respective positions to the found plane. Refer to {@link TriangleIndexVectors<2>} for more information.
+        */
+        std::tuple<Plane, double, std::variant<TriangleIndexVectors<2>, PlaneEventVectors<2> > > findPlane(
+            const SplitParam &splitParam) override;
+
+    private:
+        /**
+         * Counts per bin how many faces start and how many faces end in it.
+         */
+        struct Histogram {
+            std::array<std::array<size_t, BINS>, DIMENSIONS> starts{};
+            std::array<std::array<size_t, BINS>, DIMENSIONS> ends{};
+        };
+
+        /**
+         * The number of faces a chunk, whose histogram is built by a single task, contains at least.
+         */
+        constexpr static size_t CHUNK_SIZE{4096};
+
+        /**
+         * Returns the bin a coordinate falls into.
+         * @param coordinate The coordinate.
+         * @param min The lower border of the bounding box in the considered dimension.
+         * @param width The width of a bin in the considered dimension.
+         * @return the bin index in [0, BINS).
+         */
+        static size_t binIndex(double coordinate, double min, double width);
+
+        /**
+         * Splits the faces by a plane using the bounding boxes of their clipped parts.
+         * @param boundFaces The faces to split.
+         * @param clippedBoxes The bounding boxes of the faces clipped to the node's bounding box.
+         * @param plane The plane to split the faces by.
+         * @return Three triangle lists: the faces with area in the lesser box, the faces with area in the greater box and the faces lying in the plane.
+         */
+        static TriangleIndexVectors<3> containedTriangles(const TriangleIndexVector &boundFaces,
+                                                          const std::vector<Box> &clippedBoxes, const Plane &plane);
+    };
+} // namespace kdtree
@@ -5,8 +5,8 @@ namespace kdtree {
     std::tuple<Plane, double, std::variant<TriangleIndexVectors<2>, PlaneEventVectors<2> > > LogNPlane::findPlane(
         const SplitParam &splitParam) {
         const PlaneEventVector events{std::move(generatePlaneEvents(splitParam))};
-        TriangleCounter triangleCounter{3, {0, countFaces(splitParam.boundFaces), 0}};
-        auto [optPlane, cost, minSide] = traversePlaneEvents(events, triangleCounter, splitParam.boundingBox);
+        auto [optPlane, cost, minSide] = traversePlaneEvents(events, splitParam.faceCount,
+                                                             splitParam.boundingBox, splitParam.options);
         //generate the triangle index lists for the child bounding boxes and return them along with the optimal plane and the plane's cost.
         return {optPlane, cost, generatePlaneEventSubsets(splitParam, events, optPlane, minSide)};
     }
@@ -15,47 +15,81 @@ namespace kdtree {
         if (std::holds_alternative<TriangleIndexVector>(splitParam.boundFaces)) {
             return generatePlaneEventsFromFaces(splitParam, ALL_DIRECTIONS);
         }
-        return std::get<PlaneEventVector>(splitParam.boundFaces);
+        return PlaneEventVector(std::get<PlaneEventVector>(splitParam.boundFaces), splitParam.arena.get());
     }
 
     PlaneEventVectors<2> LogNPlane::generatePlaneEventSubsets(const SplitParam &splitParam,
                                                               const PlaneEventVector &planeEvents, const Plane &plane,
                                                               const bool minSide) {
-        const auto faceClassification{classifyTrianglesRelativeToPlane(planeEvents, plane, minSide)};
-        PlaneEventVector planeEventsMin{};
-        PlaneEventVector planeEventsMax{};
-        TriangleIndexVector facesIndexBoth{};
-        planeEventsMin.reserve(planeEvents.size() / 2);
-        planeEventsMax.reserve(planeEvents.size() / 2);
+        const FaceMarker::Lease faceClassification{FaceMarker::acquire()};
+        classifyTrianglesRelativeToPlane(planeEvents, plane, minSide, *faceClassification);
+        const FaceMarker &classification{*faceClassification};
+        //face of event only contributes to min side (0) or max side (1) -> event can be added to side without clipping because no overlap with split plane
+        //face has area on both sides (2) -> event has to be discarded and scheduled for separate event generation
+        const auto sideOf = [&classification](const PlaneEvent &event) -> size_t {
+            switch (static_cast<Locale>(classification.get(event.faceIndex))) {
+                case Locale::MIN_ONLY:
+                    return 0;
+                case Locale::MAX_ONLY:
+                    return 1;
+                default:
+                    return 2;
+            }
+        };
+        //stable partition by a prefix sum over the per chunk counts of each side, so that the partitions stay sorted
+        const size_t chunkCount{std::max<size_t>(1, (planeEvents.size() + CHUNK_SIZE - 1) / CHUNK_SIZE)};
+        std::vector<std::array<size_t, 3> > chunkOffsets(chunkCount);
+        thrust::for_each(thrust::device, thrust::counting_iterator<size_t>(0),
+                         thrust::counting_iterator<size_t>(chunkCount),
+                         [&planeEvents, &chunkOffsets, &sideOf](const size_t chunk) {
+                             const size_t end{std::min(planeEvents.size(), (chunk + 1) * CHUNK_SIZE)};
+                             for (size_t i = chunk * CHUNK_SIZE; i < end; ++i) {
+                                 ++chunkOffsets[chunk][sideOf(planeEvents[i])];
+                             }
+                         });
+        std::array<size_t, 3> sideSizes{};
+        for (auto &offsets: chunkOffsets) {
+            for (size_t side = 0; side < sideSizes.size(); ++side) {
+                const size_t count{offsets[side]};
+                offsets[side] = sideSizes[side];
+                sideSizes[side] += count;
+            }
+        }
+        std::pmr::memory_resource *arena{splitParam.arena.get()};
+        PlaneEventVector planeEventsMin(sideSizes[0], arena);
+        PlaneEventVector planeEventsMax(sideSizes[1], arena);
+        //the faces of the discarded events, each face is contained once per event
+        TriangleIndexVector straddlingFaces(sideSizes[2], arena);
+        thrust::for_each(thrust::device, thrust::counting_iterator<size_t>(0),
+                         thrust::counting_iterator<size_t>(chunkCount),
+                         [&planeEvents, &chunkOffsets, &sideOf, &planeEventsMin, &planeEventsMax, &straddlingFaces](
+                     const size_t chunk) {
+                             auto &offsets{chunkOffsets[chunk]};
+                             const size_t end{std::min(planeEvents.size(), (chunk + 1) * CHUNK_SIZE)};
+                             for (size_t i = chunk * CHUNK_SIZE; i < end; ++i) {
+                                 const PlaneEvent &event{planeEvents[i]};
+                                 switch (const size_t side{sideOf(event)}) {
+                                     case 0:
+                                         planeEventsMin[offsets[side]++] = event;
+                                         break;
+                                     case 1:
+                                         planeEventsMax[offsets[side]++] = event;
+                                         break;
+                                     default:
+                                         straddlingFaces[offsets[side]++] = event.faceIndex;
+                                 }
+                             }
+                         });
+        //schedule each straddling face once, in the order of its first event
+        TriangleIndexVector facesIndexBoth{arena};
         //value estimation taken from source paper
         facesIndexBoth.reserve(std::ceil(std::sqrt(planeEvents.size())));
-        std::unordered_set<size_t> processedIndices{};
-
-        auto insertToBothIfAbsent = [&facesIndexBoth, &processedIndices](const auto faceIndex) {
-            if (processedIndices.find(faceIndex) == processedIndices.end()) {
-                processedIndices.insert(faceIndex);
+        for (const size_t faceIndex: straddlingFaces) {
+            if (faceClassification->get(faceIndex) == static_cast<uint8_t>(Locale::BOTH)) {
                 facesIndexBoth.push_back(faceIndex);
+                faceClassification->set(faceIndex, static_cast<uint8_t>(Locale::BOTH_COLLECTED));
             }
-        };
-
-        std::for_each(planeEvents.cbegin(), planeEvents.cend(),
-                      [&faceClassification, &planeEventsMin, &planeEventsMax, &insertToBothIfAbsent
-                      ](const auto &event) {
-                          switch (faceClassification.at(event.faceIndex)) {
-                              //face of event only contributes to min side event can be added to side without clipping because no overlap with split plane
-                              case Locale::MIN_ONLY:
-                                  planeEventsMin.push_back(event);
-                                  break;
-                              //face of event only contributes to max side event can be added to side without clipping because no overlap with split plane
-                              case Locale::MAX_ONLY:
-                                  planeEventsMax.push_back(event);
-                                  break;
-                              //face has area on both sides -> event has to be discarded and scheduled for separate event generation
-                              case Locale::BOTH:
-                              default:
-                                  insertToBothIfAbsent(event.faceIndex);
-                          }
-                      });
+        }
 
         //generate new plane events for straddling faces that were discarded previously
         auto [newMinEvents, newMaxEvents] = generatePlaneEventsForClippedFaces(splitParam, facesIndexBoth, plane);
@@ -66,106 +100,130 @@ namespace kdtree {
         };
     }
 
-    std::unordered_map<size_t, LogNPlane::Locale> LogNPlane::classifyTrianglesRelativeToPlane(
-        const PlaneEventVector &events, const Plane &plane, const bool minSide) {
-        std::unordered_map<size_t, Locale> result{};
-        //each face generates 6 plane events on average, thus the amount of faces can be roughly estimated.
-        result.reserve(events.size() / 6);
-        //preparing the map by initializing all faces with them having area in both sub bounding boxes
-        std::for_each(events.cbegin(), events.cend(), [&result](const auto &event) {
-            result[event.faceIndex] = Locale::BOTH;
-        });
-        //now search for conditions proving that the faces DO NOT have area in both boxes
-        std::for_each(events.begin(), events.end(), [minSide, &result, &plane](const auto &event) {
-            if (event.type == PlaneEventType::ending && event.plane.orientation == plane.orientation && event.plane.
-                axisCoordinate <= plane.axisCoordinate) {
-                result[event.faceIndex] = Locale::MIN_ONLY;
-            } else if (event.type == PlaneEventType::starting && event.plane.orientation == plane.orientation && event.
-                       plane.axisCoordinate >= plane.axisCoordinate) {
-                result[event.faceIndex] = Locale::MAX_ONLY;
-            } else if (event.type == PlaneEventType::planar && event.plane.orientation == plane.orientation) {
-                if (event.plane.axisCoordinate < plane.axisCoordinate || (
-                        event.plane.axisCoordinate == plane.axisCoordinate && minSide)) {
-                    result[event.faceIndex] = Locale::MIN_ONLY;
+    void LogNPlane::classifyTrianglesRelativeToPlane(const PlaneEventVector &events, const Plane &plane,
+                                                     const bool minSide, FaceMarker &classification) {
+        //the cleared marker classifies all faces as having area in both sub bounding boxes, now search for conditions proving that the faces DO NOT have area in both boxes
+        //the keys preserve the order of the coordinates -> compare the keys instead of decoding every event
+        const uint64_t planeKey{PlaneEvent::toKey(plane.axisCoordinate)};
+        //only the events of the plane's axis can prove a face to lie on one side
+        const auto [axisBegin, axisEnd] = axisStreams(events)[static_cast<size_t>(plane.orientation)];
+        std::for_each(axisBegin, axisEnd, [minSide, &classification, planeKey](const auto &event) {
+            const PlaneEventType type{event.type()};
+            if (type == PlaneEventType::ending && event.key <= planeKey) {
+                classification.set(event.faceIndex, static_cast<uint8_t>(Locale::MIN_ONLY));
+            } else if (type == PlaneEventType::starting && event.key >= planeKey) {
+                classification.set(event.faceIndex, static_cast<uint8_t>(Locale::MAX_ONLY));
+            } else if (type == PlaneEventType::planar) {
+                if (event.key < planeKey || (event.key == planeKey && minSide)) {
+                    classification.set(event.faceIndex, static_cast<uint8_t>(Locale::MIN_ONLY));
                 }
-                if (event.plane.axisCoordinate > plane.axisCoordinate || (
-                        event.plane.axisCoordinate == plane.axisCoordinate && !minSide)) {
-                    result[event.faceIndex] = Locale::MAX_ONLY;
+                if (event.key > planeKey || (event.key == planeKey && !minSide)) {
+                    classification.set(event.faceIndex, static_cast<uint8_t>(Locale::MAX_ONLY));
                 }
             }
         });
-        return result;
     }
 
     std::array<PlaneEventVector, 2> LogNPlane::generatePlaneEventsForClippedFaces(
         const SplitParam &splitParam, const TriangleIndexVector &faceIndices, const Plane &plane) {
-        auto [minBox, maxBox] = splitParam.boundingBox.splitBox(plane);
-        PlaneEventVector minEvents{};
-        PlaneEventVector maxEvents{};
-        //each face generates six new PlaneEvents and each face has area in both boxes
-        minEvents.resize(faceIndices.size() * 6);
-        maxEvents.resize(faceIndices.size() * 6);
-
-        //lambda for creating PlaneEvents from a vertex triplet (face) in one of the two sub boxes
-        const auto createPlaneEvents = [](const auto &vertices, const auto &boundingBox, const size_t faceIndex,
-                                          auto destIt) {
-            //clip to the voxel
-            auto clipped = boundingBox.clipToVoxel(vertices);
-            //create split plane anchor points using the bounding box
-            const auto [minPoint, maxPoint] = Box::getBoundingBox(clipped);
-            //associate parameters for PlaneEvent creation
-            std::array<std::pair<const Array3, PlaneEventType>, 2> planeEventParam{
-                std::make_pair(minPoint, PlaneEventType::starting),
-                std::make_pair(maxPoint, PlaneEventType::ending)
-            };
-            //create planes in each dimension, be careful to cluster similar anchor points together.
-            size_t planeIndex = 0;
-            for (const auto &[point, eventType]: planeEventParam) {
-                for (const auto &direction: ALL_DIRECTIONS) {
-                    //insert directly for parallelization
-                    *(destIt + planeIndex++) = PlaneEvent(eventType, Plane(point, direction), faceIndex);
-                }
-            }
+        const auto [minBox, maxBox] = splitParam.boundingBox.splitBox(plane);
+        const std::array<Box, 2> childBoxes{minBox, maxBox};
+        //first pass: clip each face to both sub boxes and count its events, a face clipped away entirely in one box generates no events there
+        std::array<std::vector<Box>, 2> clippedBounds{
+            std::vector<Box>(faceIndices.size()), std::vector<Box>(faceIndices.size())
         };
-
-        //transform faces to vertices
-        auto [begin_it, end_it] = transformIterator(faceIndices.cbegin(), faceIndices.cend(), splitParam.vertices,
-                                                    splitParam.faces);
-        std::atomic_long minIndex{0};
-        std::atomic_long maxIndex{0};
-        //create new events for each face in both sub boxes
-        thrust::for_each(thrust::device, begin_it, end_it,
-                         [&minBox, maxBox, &minEvents, &maxEvents, &createPlaneEvents, &minIndex, &maxIndex](
-                     const auto &indexAndTriplet) {
-                             const auto &[index, vertexTriplet] = indexAndTriplet;
-                             //reserve slots of 6 for the threads using the atomic counters. Size fits because of earlier resize
-                             createPlaneEvents(vertexTriplet, minBox, index, minEvents.begin() + (minIndex++ * 6));
-                             createPlaneEvents(vertexTriplet, maxBox, index, maxEvents.begin() + (maxIndex++ * 6));
+        std::array<std::vector<size_t>, 2> eventOffsets{
+            std::vector<size_t>(faceIndices.size() + 1, 0), std::vector<size_t>(faceIndices.size() + 1, 0)
+        };
+        thrust::for_each(thrust::device, thrust::counting_iterator<size_t>(0),
+                         thrust::counting_iterator<size_t>(faceIndices.size()),
+                         [&splitParam, &faceIndices, &childBoxes, &clippedBounds, &eventOffsets](const size_t position) {
+                             const IndexArray3 &face{splitParam.faces[faceIndices[position]]};
+                             const Array3Triplet vertices{
+                                 splitParam.vertices[face[0]], splitParam.vertices[face[1]], splitParam.vertices[face[2]]
+                             };
+                             for (size_t side = 0; side < childBoxes.size(); ++side) {
+                                 //clip to the voxel
+                                 const std::optional<Box> clipped{childBoxes[side].clipToVoxelBounds(vertices)};
+                                 if (clipped.has_value()) {
+                                     //create split plane anchor points using the bounding box
+                                     clippedBounds[side][position] = clipped.value();
+                                     //each face generates six new PlaneEvents
+                                     eventOffsets[side][position + 1] = 2 * DIMENSIONS;
+                                 }
+                             }
+                         });
+        std::array<PlaneEventVector, 2> events{PlaneEventVector(splitParam.arena.get()), PlaneEventVector(splitParam.arena.get())};
+        for (size_t side = 0; side < events.size(); ++side) {
+            std::partial_sum(eventOffsets[side].cbegin(), eventOffsets[side].cend(), eventOffsets[side].begin());
+            events[side].resize(eventOffsets[side].back());
+        }
+        //second pass: each face writes its events to its own slots without synchronization
+        thrust::for_each(thrust::device, thrust::counting_iterator<size_t>(0),
+                         thrust::counting_iterator<size_t>(faceIndices.size()),
+                         [&faceIndices, &clippedBounds, &eventOffsets, &events](const size_t position) {
+                             for (size_t side = 0; side < events.size(); ++side) {
+                                 size_t slot{eventOffsets[side][position]};
+                                 if (slot == eventOffsets[side][position + 1]) {
+                                     continue;
+                                 }
+                                 const Box &bounds{clippedBounds[side][position]};
+                                 //associate parameters for PlaneEvent creation
+                                 const std::array<std::pair<const Array3 &, PlaneEventType>, 2> planeEventParam{
+                                     std::make_pair(std::cref(bounds.minPoint), PlaneEventType::starting),
+                                     std::make_pair(std::cref(bounds.maxPoint), PlaneEventType::ending)
+                                 };
+                                 //create planes in each dimension, be careful to cluster similar anchor points together.
+                                 for (const auto &[point, eventType]: planeEventParam) {
+                                     for (const auto &direction: ALL_DIRECTIONS) {
+                                         events[side][slot++] = PlaneEvent(eventType, Plane(point, direction),
+                                                                           faceIndices[position]);
+                                     }
+                                 }
+                             }
                          });
+        auto &[minEvents, maxEvents] = events;
 
         //sort the lists for later merge sort integration
-        std::sort(minEvents.begin(), minEvents.end());
-        std::sort(maxEvents.begin(), maxEvents.end());
+        sortPlaneEvents(minEvents);
+        sortPlaneEvents(maxEvents);
 
-        return {minEvents, maxEvents};
+        return events;
     }
 
     std::unique_ptr<PlaneEventVector> LogNPlane::mergePlaneEventLists(const PlaneEventVector &first,
                                                                       const PlaneEventVector &second) {
-        auto first_it{first.cbegin()};
-        auto second_it{second.cbegin()};
-        auto result{std::make_unique<PlaneEventVector>()};
-        result->reserve(first.size() + second.size());
-
-        while (first_it != first.cend() || second_it != second.cend()) {
-            if (first_it == first.cend() || second_it == second.cend()) {
-                result->push_back(first_it == first.cend() ? *second_it++ : *first_it++);
-            } else if (*first_it < *second_it) {
-                result->push_back(*first_it++);
-            } else {
-                result->push_back(*second_it++);
+        //on equal events the one of the second list is taken first -> merge the second list into the first one
+        const PlaneEventVector &preferred{second};
+        const PlaneEventVector &other{first};
+        auto result{std::make_unique<PlaneEventVector>(first.size() + second.size(), first.get_allocator())};
+        //merge path: the output is divided into chunks, the start of each chunk in both inputs is found by a binary search along the chunk's diagonal
+        const auto splitDiagonal = [&preferred, &other](const size_t diagonal) {
+            size_t low{diagonal > other.size() ? diagonal - other.size() : 0};
+            size_t high{std::min(diagonal, preferred.size())};
+            while (low < high) {
+                const size_t middle{low + (high - low) / 2};
+                //the middle element of the preferred list is among the first diagonal elements of the output
+                if (!(other[diagonal - middle - 1] < preferred[middle])) {
+                    low = middle + 1;
+                } else {
+                    high = middle;
+                }
             }
-        }
+            return low;
+        };
+        const size_t chunkCount{std::max<size_t>(1, (result->size() + CHUNK_SIZE - 1) / CHUNK_SIZE)};
+        thrust::for_each(thrust::device, thrust::counting_iterator<size_t>(0),
+                         thrust::counting_iterator<size_t>(chunkCount),
+                         [&preferred, &other, &result, &splitDiagonal](const size_t chunk) {
+                             const size_t begin{chunk * CHUNK_SIZE};
+                             const size_t end{std::min(result->size(), begin + CHUNK_SIZE)};
+                             const size_t preferredBegin{splitDiagonal(begin)};
+                             const size_t preferredEnd{splitDiagonal(end)};
+                             std::merge(preferred.cbegin() + preferredBegin, preferred.cbegin() + preferredEnd,
+                                        other.cbegin() + (begin - preferredBegin), other.cbegin() + (end - preferredEnd),
+                                        result->begin() + begin);
+                         });
         return result;
     }
 } // namespace kdtree
@@ -2,24 +2,26 @@
 
 #include <algorithm>
 #include <array>
-#include <atomic>
+#include <functional>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <iterator>
 #include <memory>
+#include <numeric>
 #include <tuple>
-#include <unordered_map>
-#include <unordered_set>
 #include <utility>
 #include <variant>
 #include <vector>
 
+#include "KDTree/tree/FaceMarker.h"
 #include "KDTree/tree/KdDefinitions.h"
 #include "KDTree/tree/SplitParam.h"
 #include "KDTree/plane_selection/PlaneEventAlgorithm.h"
 #include "KDTree/util/UtilityContainer.h"
 #include "thrust/detail/execution_policy.h"
 #include "thrust/execution_policy.h"
+#include "thrust/iterator/counting_iterator.h"
 #include "thrust/iterator/iterator_facade.h"
 #include "thrust/iterator/transform_iterator.h"
 #include "thrust/system/detail/sequential/for_each.h"
@@ -32,6 +34,11 @@ struct SplitParam;
         std::tuple<Plane, double, std::variant<TriangleIndexVectors<2>, PlaneEventVectors<2>>> findPlane(const SplitParam &splitParam) override;
 
     private:
+        /**
+         * The number of events a chunk, which is partitioned or merged by a single task, contains at least.
+         */
+        constexpr static size_t CHUNK_SIZE{16384};
+
         /**
         * Generates the vector of PlaneEvents comprising all the possible candidate planes. {@link PlaneEvent}
         * @param splitParam Contains the parameters of the scene to find candidate planes for. {@link SplitParam}
@@ -49,20 +56,27 @@ struct SplitParam;
         */
         static PlaneEventVectors<2> generatePlaneEventSubsets(const SplitParam &splitParam, const PlaneEventVector &planeEvents, const Plane &plane, bool minSide);
 
-        enum class Locale {
+        /**
+         * The position of a face relative to the split plane, stored in a {@link FaceMarker}. BOTH is 0, so that unclassified faces have area on both sides.
+         */
+        enum class Locale : uint8_t {
+            BOTH = 0,
             MIN_ONLY,
             MAX_ONLY,
-            BOTH
+            /**
+             * A face with area on both sides that has already been scheduled for clipping.
+             */
+            BOTH_COLLECTED
         };
 
         /**
-         * Creates a lookup table for face indices determining whether the faces has area only left of, only right of or on both sides of the box divided by the plane.
+         * Fills a lookup table for face indices determining whether the faces has area only left of, only right of or on both sides of the box divided by the plane.
          * @param events The list of events whose faces to classify.
          * @param plane The plane tht divides the faces into two sets.
-         * @param minSide
-         * @return An unordered_map used for lookups of individual face locales.
+         * @param minSide Whether to include planar faces to the bounding box closer to the origin.
+         * @param classification The cleared marker to store the {@link Locale} of the faces in.
          */
-        static std::unordered_map<size_t, Locale> classifyTrianglesRelativeToPlane(const PlaneEventVector &events, const Plane &plane, bool minSide);
+        static void classifyTrianglesRelativeToPlane(const PlaneEventVector &events, const Plane &plane, bool minSide, FaceMarker &classification);
 
         /**
         * Creates new events for two sub bounding boxes out of faces that overlap both of them.
@@ -77,7 +91,7 @@ struct SplitParam;
          * Takes two sorted PlaneEventLists and merges them in a single merge sort step.
          * @param first The first PlaneEventList.
          * @param second The second PlaneEventList
-         * @return A unique_ptr to a combined sorted PlaneEventList.
+         * @return A unique_ptr to a combined sorted PlaneEventList. Events of the second list precede equal events of the first list.
          */
         static std::unique_ptr<PlaneEventVector> mergePlaneEventLists(const PlaneEventVector &first, const PlaneEventVector &second);
     };
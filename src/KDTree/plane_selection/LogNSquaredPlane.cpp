@@ -6,7 +6,7 @@ namespace kdtree {
     LogNSquaredPlane::findPlane(const SplitParam &splitParam) {
         Plane optPlane{};
         double cost{std::numeric_limits<double>::infinity()};
-        PlaneEventVector optimalEvents{};
+        PlaneEventVector optimalEvents{splitParam.arena.get()};
         bool minSide{true};
         for (const auto dimension: ALL_DIRECTIONS) {
             splitParam.splitDirection = dimension;
@@ -30,16 +30,16 @@ namespace kdtree {
     std::tuple<Plane, double, PlaneEventVector, bool> LogNSquaredPlane::findPlaneForSingleDimension(
         const SplitParam &splitParam) {
         const PlaneEventVector events{std::move(generatePlaneEventsFromFaces(splitParam, {splitParam.splitDirection}))};
-        TriangleCounter triangleCounter{1, {0, countFaces(splitParam.boundFaces), 0}};
-        auto [optPlane, cost, minSide] = traversePlaneEvents(events, triangleCounter, splitParam.boundingBox);
+        auto [optPlane, cost, minSide] = traversePlaneEvents(events, splitParam.faceCount,
+                                                             splitParam.boundingBox, splitParam.options);
         return {optPlane, cost, events, minSide};
     }
 
 
     TriangleIndexVectors<2> LogNSquaredPlane::generateTriangleSubsets(const PlaneEventVector &planeEvents,
                                                                       const Plane &plane, const bool minSide) {
-        auto facesMin = std::make_unique<TriangleIndexVector>();
-        auto facesMax = std::make_unique<TriangleIndexVector>();
+        auto facesMin = std::make_unique<TriangleIndexVector>(planeEvents.get_allocator().resource());
+        auto facesMax = std::make_unique<TriangleIndexVector>(planeEvents.get_allocator().resource());
         //set data structure to avoid processing faces twice -> introduces O(1) lookup instead of O(n) lookup using the vectors directly
         std::unordered_set<size_t> facesMinLookup{};
         std::unordered_set<size_t> facesMaxLookup{};
@@ -70,17 +70,17 @@ namespace kdtree {
                                  }
                              };
                              //sort the triangles by inferring their position from the event's candidate split plane
-                             if (event.plane.axisCoordinate != plane.axisCoordinate) {
-                                 insertIfAbsent(event.faceIndex,
-                                                event.plane.axisCoordinate < plane.axisCoordinate ? 0 : 1);
+                             const double eventCoordinate{event.plane().axisCoordinate};
+                             if (eventCoordinate != plane.axisCoordinate) {
+                                 insertIfAbsent(event.faceIndex, eventCoordinate < plane.axisCoordinate ? 0 : 1);
                              }
                              //the triangle is in, starting or ending in the plane to split by -> the PlanarEventType signals its position then
-                             else if (event.type == PlaneEventType::planar) {
+                             else if (event.type() == PlaneEventType::planar) {
                                  //minSide specifies where to include planar faces
                                  insertIfAbsent(event.faceIndex, minSide ? 0 : 1);
                              }
                              //the face starts in the plane, thus its area overlaps with the bounding box further away from the origin.
-                             else if (event.type == PlaneEventType::starting) {
+                             else if (event.type() == PlaneEventType::starting) {
                                  insertIfAbsent(event.faceIndex, 1);
                              }
                              //the face ends in the plane, thus its area overlaps with the bounding box closer to the origin.
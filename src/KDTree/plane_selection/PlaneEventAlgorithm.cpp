@@ -1,139 +1,198 @@
 #include "KDTree/plane_selection/PlaneEventAlgorithm.h"
 
 namespace kdtree {
-    TriangleCounter::TriangleCounter(const size_t dimensionCount, const std::array<size_t, 3> &initialValues)
-        : dimensionTriangleValues(dimensionCount, initialValues) {
-        if (dimensionCount == 0) {
-            throw std::invalid_argument("Dimension count must be greater than zero");
-        }
-    }
-
-    void TriangleCounter::updateMax(Direction direction, const size_t p_planar, const size_t p_end) {
-        dimensionTriangleValues.at(static_cast<size_t>(direction) % dimensionTriangleValues.size()).at(1) -= p_planar +
-                p_end;
-    }
-
-    void TriangleCounter::updateMin(Direction direction, const size_t p_planar, const size_t p_start) {
-        dimensionTriangleValues.at(static_cast<size_t>(direction) % dimensionTriangleValues.size()).at(0) += p_planar +
-                p_start;
-    }
-
-    void TriangleCounter::setPlanar(Direction direction, const size_t p_planar) {
-        dimensionTriangleValues.at(static_cast<size_t>(direction) % dimensionTriangleValues.size()).at(2) = p_planar;
-    }
-
-    size_t TriangleCounter::getMin(Direction direction) const {
-        return dimensionTriangleValues.at(static_cast<size_t>(direction) % dimensionTriangleValues.size()).at(0);
-    }
-
-    size_t TriangleCounter::getMax(Direction direction) const {
-        return dimensionTriangleValues.at(static_cast<size_t>(direction) % dimensionTriangleValues.size()).at(1);
-    }
-
-    size_t TriangleCounter::getPlanar(Direction direction) const {
-        return dimensionTriangleValues.at(static_cast<size_t>(direction) % dimensionTriangleValues.size()).at(2);
-    }
-
     PlaneEventVector PlaneEventAlgorithm::generatePlaneEventsFromFaces(const SplitParam &splitParam,
                                                                        std::vector<Direction> directions) {
-        // each face has min and max point and each proposes a plane in each of the directions
-        PlaneEventVector events{};
-        events.reserve(countFaces(splitParam.boundFaces) * 2 * directions.size());
-        //mutex used for synchronizing insertions through threads
-        std::mutex eventsMutex{};
         if (std::holds_alternative<PlaneEventVector>(splitParam.boundFaces)) {
-            return std::get<PlaneEventVector>(splitParam.boundFaces);
+            return PlaneEventVector(std::get<PlaneEventVector>(splitParam.boundFaces), splitParam.arena.get());
         }
         const auto &boundTriangles{std::get<TriangleIndexVector>(splitParam.boundFaces)};
-        //transform the faces into vertices
-        auto [vertex3_begin, vertex3_end] = transformIterator(boundTriangles.cbegin(), boundTriangles.cend(),
-                                                              splitParam.vertices, splitParam.faces);
-        thrust::for_each(thrust::device, vertex3_begin, vertex3_end,
-                         [&splitParam, &events, &directions, &eventsMutex](const auto &indexAndTriplet) {
-                             const auto [index, triplet] = indexAndTriplet;
+        // each face has min and max point and each proposes a plane in each of the directions
+        const auto forEachEvent = [&directions](const Array3 &minPoint, const Array3 &maxPoint, const size_t index,
+                                                const auto &emit) {
+            for (const auto &direction: directions) {
+                // if the triangle is perpendicular to the split direction, generate a planar event with the candidate plane in which the triangle lies
+                if (minPoint[static_cast<int>(direction)] == maxPoint[static_cast<int>(direction)]) {
+                    emit(PlaneEvent(PlaneEventType::planar, Plane(minPoint, direction), index));
+                    return;
+                }
+                //else create a starting and ending event consisting of the planes defined by the min and max points of the face's bounding box.
+                emit(PlaneEvent(PlaneEventType::starting, Plane(minPoint, direction), index));
+                emit(PlaneEvent(PlaneEventType::ending, Plane(maxPoint, direction), index));
+            }
+        };
+        //first pass: clip each face once and count its events. The counts are scanned to exact slots, into which each face writes its events without synchronization
+        std::vector<Box> faceBounds(boundTriangles.size());
+        std::vector<size_t> eventOffsets(boundTriangles.size() + 1, 0);
+        thrust::for_each(thrust::device, thrust::counting_iterator<size_t>(0),
+                         thrust::counting_iterator<size_t>(boundTriangles.size()),
+                         [&splitParam, &boundTriangles, &faceBounds, &eventOffsets, &forEachEvent](const size_t position) {
+                             const size_t index{boundTriangles[position]};
+                             const IndexArray3 &face{splitParam.faces[index]};
                              //first clip the triangles vertices to the current bounding box and then get the bounding box of the clipped triangle -> use the box edges as split plane candidates
-                             const auto [minPoint, maxPoint] = Box::getBoundingBox<std::vector<Array3> >(
-                                 splitParam.boundingBox.clipToVoxel(triplet));
-                             std::lock_guard lock(eventsMutex);
-                             for (const auto &direction: directions) {
-                                 // if the triangle is perpendicular to the split direction, generate a planar event with the candidate plane in which the triangle lies
-                                 if (minPoint[static_cast<int>(direction)] == maxPoint[static_cast<int>(direction)]) {
-                                     events.emplace_back(
-                                         PlaneEventType::planar,
-                                         Plane(minPoint, direction),
-                                         index);
-                                     return;
-                                 }
-                                 //else create a starting and ending event consisting of the planes defined by the min and max points of the face's bounding box.
-                                 events.emplace_back(
-                                     PlaneEventType::starting,
-                                     Plane(minPoint, direction),
-                                     index);
-                                 events.emplace_back(
-                                     PlaneEventType::ending,
-                                     Plane(maxPoint, direction),
-                                     index);
-                             }
+                             faceBounds[position] = splitParam.boundingBox.clipToVoxelBounds(
+                                 {splitParam.vertices[face[0]], splitParam.vertices[face[1]], splitParam.vertices[face[2]]}).value_or(Box{});
+                             size_t count{0};
+                             forEachEvent(faceBounds[position].minPoint, faceBounds[position].maxPoint, index,
+                                          [&count](const PlaneEvent &) { ++count; });
+                             eventOffsets[position + 1] = count;
+                         });
+        std::partial_sum(eventOffsets.cbegin(), eventOffsets.cend(), eventOffsets.begin());
+        //second pass: write the events to their slots, the events keep the order of the faces
+        PlaneEventVector events(eventOffsets.back(), splitParam.arena.get());
+        thrust::for_each(thrust::device, thrust::counting_iterator<size_t>(0),
+                         thrust::counting_iterator<size_t>(boundTriangles.size()),
+                         [&boundTriangles, &faceBounds, &eventOffsets, &events, &forEachEvent](const size_t position) {
+                             size_t slot{eventOffsets[position]};
+                             forEachEvent(faceBounds[position].minPoint, faceBounds[position].maxPoint, boundTriangles[position],
+                                          [&events, &slot](const PlaneEvent &event) { events[slot++] = event; });
                          });
-        //reduce size
-        events.shrink_to_fit();
         //sort the events by plane position and then by PlaneEventType. Refer to {@link PlaneEventType} for the specific order
-        std::sort(events.begin(), events.end());
+        sortPlaneEvents(events);
         return events;
     }
 
     std::tuple<Plane, double, bool> PlaneEventAlgorithm::traversePlaneEvents(
-        const PlaneEventVector &events, TriangleCounter &triangleCounter, const Box &boundingBox) {
+        const PlaneEventVector &events, const size_t faceCount, const Box &boundingBox, const BuildOptions &options) {
+        const auto streams{axisStreams(events)};
+        std::array<std::tuple<Plane, double, bool>, DIMENSIONS> axisResults{};
+        //the axes are independent of each other -> sweep them concurrently
+        thrust::for_each(thrust::device, thrust::counting_iterator<size_t>(0),
+                         thrust::counting_iterator<size_t>(DIMENSIONS),
+                         [&streams, &axisResults, faceCount, &boundingBox, &options](const size_t axis) {
+                             axisResults[axis] = sweepAxis(streams[axis], faceCount, boundingBox, options);
+                         });
+        //initialize the default plane and make it costly
+        double cost{std::numeric_limits<double>::infinity()};
+        Plane optPlane{};
+        bool minSide{true};
+        for (const auto &[candidatePlane, candidateCost, minSideChosen]: axisResults) {
+            // on equal cost choose the plane with the lower coordinate and then the lower dimension to consistently build the same KDTree.
+            // this is not important for functionality but for testing purposes
+            if (candidateCost < cost || (candidateCost == cost && candidatePlane.axisCoordinate < optPlane.axisCoordinate)) {
+                cost = candidateCost;
+                optPlane = candidatePlane;
+                minSide = minSideChosen;
+            }
+        }
+        //return the optimal plane and the plane's cost along with the halfspace to which planar faces are included.
+        return {optPlane, cost, minSide};
+    }
+
+    std::tuple<Plane, double, bool> PlaneEventAlgorithm::sweepAxis(const PlaneEventRange &events,
+                                                                   const size_t faceCount, const Box &boundingBox,
+                                                                   const BuildOptions &options) {
         //initialize the default plane and make it costly
         double cost{std::numeric_limits<double>::infinity()};
         Plane optPlane{};
         bool minSide{true};
+        //all faces start on the max side of the first plane
+        size_t trianglesMin{0}, trianglesMax{faceCount};
         //traverse all the events
-        int i{0};
-        while (i < events.size()) {
+        auto it{events.first};
+        while (it != events.second) {
             //poll a plane to test
-            const Plane &candidatePlane = events[i].plane;
+            const Plane candidatePlane{it->plane()};
+            const uint64_t candidateKey{it->key};
             //for each plane calculate the faces whose vertices lie in the plane. Differentiate between the face starting in the plane, ending in the plane or all vertices lying in the plane
-            size_t p_start{0}, p_end{0}, p_planar{0};
-            //count all faces that end in the plane, this works because the PlaneEvents are sorted by position and then by PlaneEventType
-            while (i < events.size() && events[i].plane.orientation == candidatePlane.orientation && events[i].plane.
-                   axisCoordinate == candidatePlane.axisCoordinate && events[i].type == PlaneEventType::ending) {
-                p_end++;
-                i++;
+            std::array<size_t, 3> typeCount{};
+            //count the faces ending in, lying in and starting in the plane, this works because the PlaneEvents are sorted by position and then by PlaneEventType
+            for (; it != events.second && it->key == candidateKey; ++it) {
+                ++typeCount[static_cast<size_t>(it->type())];
             }
-            //count all the faces that lie in the plane
-            while (i < events.size() && events[i].plane.orientation == candidatePlane.orientation && events[i].plane.
-                   axisCoordinate == candidatePlane.axisCoordinate && events[i].type == PlaneEventType::planar) {
-                p_planar++;
-                i++;
-            }
-            //count all the faces that start in the plane
-            while (i < events.size() && events[i].plane.orientation == candidatePlane.orientation && events[i].plane.
-                   axisCoordinate == candidatePlane.axisCoordinate && events[i].type == PlaneEventType::starting) {
-                p_start++;
-                i++;
-            }
-            //reference to the triangle counter of the current dimension -> better readability
-            triangleCounter.setPlanar(candidatePlane.orientation, p_planar);
-            triangleCounter.updateMax(candidatePlane.orientation, p_planar, p_end);
+            const size_t p_end{typeCount[static_cast<size_t>(PlaneEventType::ending)]};
+            const size_t p_planar{typeCount[static_cast<size_t>(PlaneEventType::planar)]};
+            const size_t p_start{typeCount[static_cast<size_t>(PlaneEventType::starting)]};
+            trianglesMax -= p_planar + p_end;
             //evaluate plane and update should the new plane be more efficient
-            auto [candidateCost, minSideChosen] = costForPlane(boundingBox, candidatePlane,
-                                                               triangleCounter.getMin(candidatePlane.orientation),
-                                                               triangleCounter.getMax(candidatePlane.orientation),
-                                                               triangleCounter.getPlanar(candidatePlane.orientation));
-            // this condition exists to consistently build the same KDTree (choose plane with lower coordinate) by eliminating indeterministic behavior should the cost be equal.
-            // this is not important for functionality but for testing purposes
-            bool skipEvaluation = candidateCost == cost && optPlane.axisCoordinate < candidatePlane.axisCoordinate;
-            if (candidateCost < cost && !skipEvaluation) {
+            auto [candidateCost, minSideChosen] = costForPlane(boundingBox, candidatePlane, trianglesMin, trianglesMax,
+                                                               p_planar, options);
+            //the strict comparison keeps the plane with the lower coordinate should the cost be equal
+            if (candidateCost < cost) {
                 cost = candidateCost;
                 optPlane = candidatePlane;
                 minSide = minSideChosen;
             }
             //shift the plane to the next candidate and prepare next iteration
-            triangleCounter.updateMin(candidatePlane.orientation, p_planar, p_start);
-            triangleCounter.setPlanar(candidatePlane.orientation, 0);
+            trianglesMin += p_planar + p_start;
         }
-        //return the optimal plane and the plane's cost along with the halfspace to which planar faces are included.
         return {optPlane, cost, minSide};
     }
+
+    std::array<PlaneEventRange, DIMENSIONS> PlaneEventAlgorithm::axisStreams(const PlaneEventVector &events) {
+        std::array<PlaneEventRange, DIMENSIONS> streams{};
+        auto begin{events.cbegin()};
+        for (size_t axis = 0; axis < DIMENSIONS; ++axis) {
+            //the events are sorted by orientation first -> binary search the end of the axis' stream
+            const auto end{std::partition_point(begin, events.cend(), [axis](const PlaneEvent &event) {
+                return static_cast<size_t>(event.orientation()) <= axis;
+            })};
+            streams[axis] = {begin, end};
+            begin = end;
+        }
+        return streams;
+    }
+
+    void PlaneEventAlgorithm::sortPlaneEvents(PlaneEventVector &events) {
+        //the comparison sort is stable too, so both ways yield the same order
+        if (events.size() < RADIX_SORT_THRESHOLD) {
+            std::stable_sort(events.begin(), events.end());
+            return;
+        }
+        const size_t chunkCount{(events.size() + RADIX_CHUNK_SIZE - 1) / RADIX_CHUNK_SIZE};
+        //the buffer is swapped with the events after each pass, which requires both to use the same memory resource
+        PlaneEventVector buffer(events.size(), events.get_allocator());
+        //per chunk digit counts, turned into the chunk's scatter offsets during a pass
+        std::vector<std::array<size_t, RADIX> > offsets(chunkCount);
+        //least significant digit first: the PlaneEventType, the bytes of the key and finally the orientation
+        constexpr size_t passes{sizeof(uint64_t) + 2};
+        for (size_t pass = 0; pass < passes; ++pass) {
+            const auto digit = [pass](const PlaneEvent &event) -> size_t {
+                if (pass == 0) {
+                    return event.tag % 3;
+                }
+                if (pass == passes - 1) {
+                    return event.tag / 3;
+                }
+                return (event.key >> (8 * (pass - 1))) & 0xFF;
+            };
+            //each chunk counts its digits independently
+            thrust::for_each(thrust::device, thrust::counting_iterator<size_t>(0),
+                             thrust::counting_iterator<size_t>(chunkCount),
+                             [&events, &offsets, &digit](const size_t chunk) {
+                                 auto &counts{offsets[chunk]};
+                                 counts.fill(0);
+                                 const size_t end{std::min(events.size(), (chunk + 1) * RADIX_CHUNK_SIZE)};
+                                 for (size_t i = chunk * RADIX_CHUNK_SIZE; i < end; ++i) {
+                                     ++counts[digit(events[i])];
+                                 }
+                             });
+            //exclusive prefix sum ordered by digit and then by chunk, so that the scatter is stable
+            size_t offset{0};
+            bool singleDigit{false};
+            for (size_t value = 0; value < RADIX; ++value) {
+                const size_t digitStart{offset};
+                for (auto &counts: offsets) {
+                    const size_t count{counts[value]};
+                    counts[value] = offset;
+                    offset += count;
+                }
+                singleDigit |= offset - digitStart == events.size();
+            }
+            //all events share this digit (e.g. the exponent bytes of similar coordinates) -> the pass would not change the order
+            if (singleDigit) {
+                continue;
+            }
+            thrust::for_each(thrust::device, thrust::counting_iterator<size_t>(0),
+                             thrust::counting_iterator<size_t>(chunkCount),
+                             [&events, &buffer, &offsets, &digit](const size_t chunk) {
+                                 auto &chunkOffsets{offsets[chunk]};
+                                 const size_t end{std::min(events.size(), (chunk + 1) * RADIX_CHUNK_SIZE)};
+                                 for (size_t i = chunk * RADIX_CHUNK_SIZE; i < end; ++i) {
+                                     buffer[chunkOffsets[digit(events[i])]++] = events[i];
+                                 }
+                             });
+            events.swap(buffer);
+        }
+    }
 } // namespace kdtree
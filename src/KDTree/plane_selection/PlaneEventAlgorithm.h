@@ -3,10 +3,13 @@
 #include <algorithm>
 #include <array>
 #include <cstddef>
+#include <cstdint>
 #include <limits>
 #include <mutex>
+#include <numeric>
 #include <stdexcept>
 #include <tuple>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -16,6 +19,7 @@
 #include "KDTree/util/UtilityContainer.h"
 #include "thrust/detail/execution_policy.h"
 #include "thrust/execution_policy.h"
+#include "thrust/iterator/counting_iterator.h"
 #include "thrust/iterator/iterator_facade.h"
 #include "thrust/iterator/transform_iterator.h"
 #include "thrust/system/detail/sequential/for_each.h"
@@ -24,83 +28,70 @@ namespace kdtree {
 struct SplitParam;
 
     /**
-     * Helper class to keep count of triangles that straddle split planes, while PlaneEvents are iterated over.
+     * A contiguous range of sorted PlaneEvents.
      */
-    class TriangleCounter {
-    public:
-        /**
-         * Update the triangle count for the max side of the plane.
-         * @param direction For which dimension to update values.
-         * @param p_planar Amount of faces lying in the plane.
-         * @param p_end Amount of faces ending in the plane.
-         */
-        void updateMax(Direction direction, size_t p_planar, size_t p_end);
+    using PlaneEventRange = std::pair<PlaneEventVector::const_iterator, PlaneEventVector::const_iterator>;
 
+    class PlaneEventAlgorithm : public PlaneSelectionAlgorithm {
+    protected:
         /**
-        * Update the triangle count for the min side of the plane.
-        * @param direction For which dimension to update values.
-        * @param p_planar Amount of faces lying in the plane.
-        * @param p_start Amount of faces starting in the plane.
+        * Generates the vector of PlaneEvents comprising all the possible candidate planes using an index list of faces. {@link PlaneEvent}
+        * @param splitParam Contains the parameters of the scene to find candidate planes for. {@link SplitParam}
+        * @param directions For which directions to generate the events for.
+        * @return The vector of PlaneEvents.
         */
-        void updateMin(Direction direction, size_t p_planar, size_t p_start);
+        static PlaneEventVector generatePlaneEventsFromFaces(const SplitParam &splitParam,
+                                                             std::vector<Direction> directions);
 
         /**
-         * Sets the amount of planar faces for a specific dimension.
-         * @param direction For which dimension to update values.
-         * @param p_planar Amount of faces lying in the plane.
+         * Iterates over PlaneEvents and determines the optimal split plane. The streams of the three axes are swept concurrently and the cheapest plane among them is chosen.
+         * @param events The sorted events to base calculations on.
+         * @param faceCount The amount of faces referenced by the events.
+         * @param boundingBox The current node's bounding box
+         * @param options The cost constants of the tree building. {@link BuildOptions}
+         * @return Tuple of optimal plane, its cost and where to include planar faces.
          */
-        void setPlanar(Direction direction, size_t p_planar);
+        static std::tuple<Plane, double, bool> traversePlaneEvents(const PlaneEventVector &events, size_t faceCount,
+                                                                   const Box &boundingBox, const BuildOptions &options);
 
         /**
-         * Returns min value for a specific dimension.
-         * @param direction The dimension.
-         * @return The min value.
+         * Splits sorted PlaneEvents into the streams of the single axes.
+         * @param events The sorted events.
+         * @return The range of the events for each orientation, empty if the events contain no plane of the orientation.
          */
-        [[nodiscard]] size_t getMin(Direction direction) const;
+        static std::array<PlaneEventRange, DIMENSIONS> axisStreams(const PlaneEventVector &events);
 
         /**
-         * Returns max value for a specific dimension.
-         * @param direction The dimension.
-         * @return The max value.
+         * Sorts PlaneEvents by orientation, plane position and PlaneEventType using a stable parallel LSD radix sort on the event's tag and key.
+         * @param events The events to sort in place.
          */
-        [[nodiscard]] size_t getMax(Direction direction) const;
+        static void sortPlaneEvents(PlaneEventVector &events);
 
+    private:
         /**
-         * Returns the amount of planar faces for a specific dimension.
-         * @param direction The dimension.
-         * @return The planar face amount.
+         * Sweeps over the events of a single axis and determines the optimal split plane among them.
+         * @param events The sorted events of one orientation.
+         * @param faceCount The amount of faces referenced by all events.
+         * @param boundingBox The current node's bounding box
+         * @param options The cost constants of the tree building. {@link BuildOptions}
+         * @return Tuple of optimal plane, its cost and where to include planar faces.
          */
-        [[nodiscard]] size_t getPlanar(Direction direction) const;
+        static std::tuple<Plane, double, bool> sweepAxis(const PlaneEventRange &events, size_t faceCount,
+                                                         const Box &boundingBox, const BuildOptions &options);
 
-        TriangleCounter(size_t dimensionCount, const std::array<size_t, 3> &initialValues);
-
-    private:
         /**
-         * Keeps track of triangle counts for every dimension in order MIN, MAX, PLANAR
+         * The number of values a single radix digit can take, each pass sorts by one byte.
          */
-        std::vector<std::array<size_t, 3> > dimensionTriangleValues;
-    };
+        constexpr static size_t RADIX{256};
 
-    class PlaneEventAlgorithm : public PlaneSelectionAlgorithm {
-    protected:
         /**
-        * Generates the vector of PlaneEvents comprising all the possible candidate planes using an index list of faces. {@link PlaneEvent}
-        * @param splitParam Contains the parameters of the scene to find candidate planes for. {@link SplitParam}
-        * @param directions For which directions to generate the events for.
-        * @return The vector of PlaneEvents.
-        */
-        static PlaneEventVector generatePlaneEventsFromFaces(const SplitParam &splitParam,
-                                                             std::vector<Direction> directions);
+         * The number of events a chunk, which is counted and scattered by a single task, contains at least.
+         */
+        constexpr static size_t RADIX_CHUNK_SIZE{16384};
 
         /**
-         * Iterates over PlaneEvents and determines the optimal split plane.
-         * @param events The events to base calculations on.
-         * @param triangleCounter Used to track face count during iteration.
-         * @param boundingBox The current node's bounding box
-         * @return Tuple of optimal plane, its cost and where to include planar faces.
+         * Lists below this size are sorted by comparison, since the radix passes do not pay off.
          */
-        static std::tuple<Plane, double, bool> traversePlaneEvents(const PlaneEventVector &events,
-                                                                   TriangleCounter &triangleCounter,
-                                                                   const Box &boundingBox);
+        constexpr static size_t RADIX_SORT_THRESHOLD{512};
     };
 } // namespace kdtree
@@ -2,7 +2,7 @@
 
 namespace kdtree {
 
-    std::pair<const double, bool> PlaneSelectionAlgorithm::costForPlane(const Box boundingBox, const Plane plane, const size_t trianglesMin, const size_t trianglesMax, const size_t trianglesPlanar) {
+    std::pair<const double, bool> PlaneSelectionAlgorithm::costForPlane(const Box boundingBox, const Plane plane, const size_t trianglesMin, const size_t trianglesMax, const size_t trianglesPlanar, const BuildOptions &options) {
         //Checks if the split plane is one of the faces of the bounding box, if so the split is useless
         if (plane.axisCoordinate == boundingBox.minPoint[static_cast<int>(plane.orientation)] || plane.axisCoordinate == boundingBox.maxPoint[static_cast<int>(plane.orientation)]) {
             //will be discarded later because not splitting is cheaper (finitely many nodes!) than using this plane (infinite cost)
@@ -15,14 +15,22 @@ namespace kdtree {
         const double surfaceArea1 = box1.surfaceArea();
         const double surfaceArea2 = box2.surfaceArea();
         //evaluate SAH: Include equalT once in each box and record option with minimum cost
-        const double costLesser = traverseStepCost + triangleIntersectionCost * (surfaceArea1 / surfaceAreaBounding * static_cast<double>(trianglesMin + trianglesPlanar) + surfaceArea2 / surfaceAreaBounding * static_cast<double>(trianglesMax));
-        const double costGreater = traverseStepCost + triangleIntersectionCost * (surfaceArea1 / surfaceAreaBounding * static_cast<double>(trianglesMin) + surfaceArea2 / surfaceAreaBounding * static_cast<double>(trianglesMax + trianglesPlanar));
-        //if empty space is cut off, reduce cost by 20%
-        const double factor = trianglesMin == 0 || trianglesMax == 0 ? 0.8 : 1;
+        const double costLesser = options.traverseStepCost + options.triangleIntersectionCost * (surfaceArea1 / surfaceAreaBounding * static_cast<double>(trianglesMin + trianglesPlanar) + surfaceArea2 / surfaceAreaBounding * static_cast<double>(trianglesMax));
+        const double costGreater = options.traverseStepCost + options.triangleIntersectionCost * (surfaceArea1 / surfaceAreaBounding * static_cast<double>(trianglesMin) + surfaceArea2 / surfaceAreaBounding * static_cast<double>(trianglesMax + trianglesPlanar));
+        //if empty space is cut off, reduce cost by the bonus
+        double bonus{trianglesMin == 0 || trianglesMax == 0 ? options.emptySpaceBonus : 0.0};
+        if (options.scaleEmptySpaceBonus && bonus > 0.0) {
+            //only the share of the node's extent that is cut off is rewarded
+            const auto axis{static_cast<size_t>(plane.orientation)};
+            const double extent{boundingBox.maxPoint[axis] - boundingBox.minPoint[axis]};
+            const double lesserFraction{trianglesMin == 0 ? (plane.axisCoordinate - boundingBox.minPoint[axis]) / extent : 0.0};
+            const double greaterFraction{trianglesMax == 0 ? (boundingBox.maxPoint[axis] - plane.axisCoordinate) / extent : 0.0};
+            bonus *= std::max(lesserFraction, greaterFraction);
+        }
+        const double factor = 1.0 - bonus;
         if (costLesser <= costGreater) {
             return {factor * costLesser, true};
         }
-        //if empty space is cut off, reduce cost by 20%
         return {factor * costGreater, false};
     }
 }// namespace kdtree
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include <utility>
 #include <variant>
 
+#include "KDTree/tree/BuildOptions.h"
 #include "KDTree/tree/KdDefinitions.h"
 
 namespace kdtree {
@@ -28,20 +29,10 @@ namespace kdtree {
             NOTREE,
             QUADRATIC,
             LOGSQUARED,
-            LOG
+            LOG,
+            BINNED
         };
 
-
-        /**
-        * Constant that describes the cost of traversing the KDTree by one step.
-        */
-        constexpr static double traverseStepCost{1.0};
-
-        /**
-        * Constant that describes the cost of intersecting a ray and a single object.
-        */
-        constexpr static double triangleIntersectionCost{1.0};
-
     protected:
         /**
        * Evaluates the cost function should the specified bounding box and it's faces be divided by the specified plane. Used to evaluate possible split planes.
@@ -50,10 +41,11 @@ namespace kdtree {
        * @param trianglesMin the number of triangles overlapping with the min side of the bounding box.
        * @param trianglesMax the number of triangles overlapping with the max side of the bounding box.
        * @param trianglesPlanar the number of triangles lying in the plane.
+       * @param options the cost constants and the bonus for cutting off empty space. {@link BuildOptions}
        * @return A pair of: 1. the cost for performing intersection operations on the finalized tree later, should the KDTree be built using the specified split plane and the triangle sets resulting through division by the plane.
        * 2. true if the planar triangles should be added to the min side of the bounding box.
        */
-        static std::pair<const double, bool> costForPlane(Box boundingBox, Plane plane, size_t trianglesMin, size_t trianglesMax, size_t trianglesPlanar);
+        static std::pair<const double, bool> costForPlane(Box boundingBox, Plane plane, size_t trianglesMin, size_t trianglesMax, size_t trianglesPlanar, const BuildOptions &options);
     };
 
 }// namespace kdtree
\ No newline at end of file
@@ -10,6 +10,8 @@ namespace kdtree {
                 return std::make_shared<SquaredPlane>();
             case Algorithm::LOGSQUARED:
                 return std::make_shared<LogNSquaredPlane>();
+            case Algorithm::BINNED:
+                return std::make_shared<BinnedPlane>();
             default:
             case Algorithm::LOG:
                 return std::make_shared<LogNPlane>();
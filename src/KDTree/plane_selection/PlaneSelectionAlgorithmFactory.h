@@ -1,5 +1,6 @@
 #pragma once
 
+#include "KDTree/plane_selection/BinnedPlane.h"
 #include "KDTree/plane_selection/LogNPlane.h"
 #include "KDTree/plane_selection/LogNSquaredPlane.h"
 #include "KDTree/plane_selection/NoTreePlane.h"
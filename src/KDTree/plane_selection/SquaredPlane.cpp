@@ -24,9 +24,7 @@ namespace kdtree {
                      const auto &indexAndTriplet) {
                              const auto [index, triplet] = indexAndTriplet;
                              //first clip the triangles vertices to the current bounding box and then get the bounding box of the clipped triangle -> use the box edges as split plane candidates
-                             const auto clippedVertices = splitParam.boundingBox.clipToVoxel(triplet);
-                             const auto [minPoint, maxPoint] = Box::getBoundingBox<std::vector<Array3> >(
-                                 clippedVertices);
+                             const auto [minPoint, maxPoint] = splitParam.boundingBox.clipToVoxelBounds(triplet).value_or(Box{});
                              for (const auto planeSurfacePoint: {minPoint, maxPoint}) {
                                  //constructs the plane that goes through a vertex lying on the bounding box of the face to be checked and spans in a specified direction.
                                  Plane candidatePlane{
@@ -47,7 +45,7 @@ namespace kdtree {
                                  //evaluate the candidate plane and store if it is better than the currently stored result
                                  auto [candidateCost, minSideChosen] = costForPlane(
                                      splitParam.boundingBox, candidatePlane, triangleIndexLists[0]->size(),
-                                     triangleIndexLists[1]->size(), triangleIndexLists[2]->size()); {
+                                     triangleIndexLists[1]->size(), triangleIndexLists[2]->size(), splitParam.options); {
                                      std::lock_guard lock(optMutex);
                                      // this if clause exists to consistently build the same KDTree (choose plane with lower coordinate) by eliminating indeterministic behavior should the cost be equal.
                                      // this is not important for functionality but for testing purposes
@@ -80,9 +78,9 @@ namespace kdtree {
         }
         const auto &boundFaces = std::get<TriangleIndexVector>(splitParam.boundFaces);
         //define three sets of triangles: closer to the origin, further away, in the plane
-        auto index_less = std::make_unique<TriangleIndexVector>();
-        auto index_greater = std::make_unique<TriangleIndexVector>();
-        auto index_equal = std::make_unique<TriangleIndexVector>();
+        auto index_less = std::make_unique<TriangleIndexVector>(boundFaces.get_allocator());
+        auto index_greater = std::make_unique<TriangleIndexVector>(boundFaces.get_allocator());
+        auto index_equal = std::make_unique<TriangleIndexVector>(boundFaces.get_allocator());
         index_less->reserve(boundFaces.size() / 2);
         index_greater->reserve(boundFaces.size() / 2);
 
@@ -96,16 +94,17 @@ namespace kdtree {
             [&splitParam, &split, &index_greater, &index_less, &index_equal](std::pair<size_t, Array3Triplet> pair) {
                 auto [faceIndex, vertices] = pair;
                 bool less{false}, greater{false};
-                auto clippedVertices = splitParam.boundingBox.clipToVoxel(vertices);
-                for (const Array3 vertex: clippedVertices) {
-                    //vertex is closer to the origin than the plane
-                    if (vertex[static_cast<int>(split.orientation)] < split.axisCoordinate && !less) {
+                const std::optional<Box> clippedBox{splitParam.boundingBox.clipToVoxelBounds(vertices)};
+                if (clippedBox.has_value()) {
+                    const auto axis{static_cast<int>(split.orientation)};
+                    //a vertex of the clipped face is closer to the origin than the plane
+                    if (clippedBox->minPoint[axis] < split.axisCoordinate) {
                         less = true;
                         //triangle has area in the closer bounding box and needs to be checked there for intersections
                         index_less->push_back(faceIndex);
                     }
-                    //vertex is farther away of the origin than the plane
-                    else if (vertex[static_cast<int>(split.orientation)] > split.axisCoordinate && !greater) {
+                    //a vertex of the clipped face is farther away of the origin than the plane
+                    if (clippedBox->maxPoint[axis] > split.axisCoordinate) {
                         greater = true;
                         //triangle has area in the greater bounding box and needs to be checked there for intersections
                         index_greater->push_back(faceIndex);
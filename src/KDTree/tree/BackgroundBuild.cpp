@@ -0,0 +1,197 @@
+#include "KDTree/tree/BackgroundBuild.h"
+
+#include <algorithm>
+
+#include "KDTree/tree/KDTree.h"
+
+namespace kdtree {
+    BackgroundBuild::BackgroundBuild(KDTree &tree, const size_t threadCount, ProgressCallback progress)
+        : _tree{tree}, _progress{std::move(progress)} {
+        //the root is the first node to build
+        _coldNodes.push_back(nullptr);
+        const size_t poolSize{threadCount != 0 ? threadCount : std::max<size_t>(std::thread::hardware_concurrency(), 1)};
+        try {
+            for (size_t i = 0; i < poolSize; ++i) {
+                _threads.emplace_back([this] { work(); });
+            }
+        } catch (...) {
+            //the started threads must not outlive the object
+            cancel();
+            for (std::thread &thread: _threads) {
+                thread.join();
+            }
+            throw;
+        }
+    }
+
+    BackgroundBuild::~BackgroundBuild() {
+        cancel();
+        std::lock_guard join{_joinMutex};
+        for (std::thread &thread: _threads) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+    }
+
+    void BackgroundBuild::prioritize(SplitNode *node) {
+        //every query passing the node calls this, only the first one queues it
+        if (_cancelled.load(std::memory_order_relaxed) || !node->markPrioritized()) {
+            return;
+        }
+        std::lock_guard lock{_mutex};
+        const auto [state, inserted] = _expanded.try_emplace(node, false);
+        //already expanded, the children are built
+        if (state->second) {
+            return;
+        }
+        if (inserted) {
+            ++_pendingNodes;
+        }
+        //a node queued in the cold frontier is expanded from the hot queue instead, its cold entry is skipped later
+        _hotNodes.push_back(node);
+        _changed.notify_one();
+    }
+
+    void BackgroundBuild::cancel() {
+        std::lock_guard lock{_mutex};
+        _cancelled.store(true, std::memory_order_relaxed);
+        _changed.notify_all();
+    }
+
+    void BackgroundBuild::wait() {
+        {
+            std::lock_guard join{_joinMutex};
+            for (std::thread &thread: _threads) {
+                if (thread.joinable()) {
+                    thread.join();
+                }
+            }
+        }
+        std::lock_guard lock{_mutex};
+        if (_exception) {
+            std::rethrow_exception(_exception);
+        }
+    }
+
+    void BackgroundBuild::work() {
+        std::unique_lock lock{_mutex};
+        while (true) {
+            //no node is queued or under construction -> the tree is complete and this thread freezes it
+            if (_hotNodes.empty() && _coldNodes.empty() && _activeThreads == 0 && !_completed &&
+                !_cancelled.load(std::memory_order_relaxed)) {
+                _completed = true;
+                const BuildProgress finished{_builtNodes, 0, true};
+                const size_t number{++_progressCount};
+                _changed.notify_all();
+                lock.unlock();
+                try {
+                    _tree.prebuildTree();
+                    report(finished, number);
+                } catch (...) {
+                    lock.lock();
+                    fail(std::current_exception());
+                }
+                return;
+            }
+            _changed.wait(lock, [this] {
+                return _cancelled.load(std::memory_order_relaxed) || _completed || !_hotNodes.empty() || !_coldNodes.empty() ||
+                       _activeThreads == 0;
+            });
+            if (_cancelled.load(std::memory_order_relaxed) || _completed) {
+                return;
+            }
+            if (_hotNodes.empty() && _coldNodes.empty()) {
+                continue;
+            }
+            const bool hot{!_hotNodes.empty()};
+            SplitNode *node;
+            if (hot) {
+                node = _hotNodes.back();
+                _hotNodes.pop_back();
+            } else {
+                node = _coldNodes.front();
+                _coldNodes.pop_front();
+            }
+            if (node != nullptr) {
+                bool &expanded{_expanded[node]};
+                //the node has been queued twice
+                if (expanded) {
+                    continue;
+                }
+                expanded = true;
+                --_pendingNodes;
+            }
+            ++_activeThreads;
+            lock.unlock();
+            std::array<TreeNode *, 2> children{};
+            std::exception_ptr exception{};
+            try {
+                children = expand(node);
+            } catch (...) {
+                exception = std::current_exception();
+            }
+            lock.lock();
+            --_activeThreads;
+            if (exception) {
+                fail(exception);
+                return;
+            }
+            for (TreeNode *child: children) {
+                if (child == nullptr) {
+                    continue;
+                }
+                ++_builtNodes;
+                auto *split = dynamic_cast<SplitNode *>(child);
+                //children reached by a query before have already been queued
+                if (split == nullptr || !_expanded.try_emplace(split, false).second) {
+                    continue;
+                }
+                ++_pendingNodes;
+                //the subtree of a node reached by a query is completed first, the queries reaching its nodes don't need to queue them again
+                if (hot) {
+                    split->markPrioritized();
+                    _hotNodes.push_back(split);
+                } else {
+                    _coldNodes.push_back(split);
+                }
+            }
+            const BuildProgress progress{_builtNodes, _pendingNodes, false};
+            const size_t number{++_progressCount};
+            _changed.notify_all();
+            lock.unlock();
+            try {
+                report(progress, number);
+            } catch (...) {
+                lock.lock();
+                fail(std::current_exception());
+                return;
+            }
+            lock.lock();
+        }
+    }
+
+    std::array<TreeNode *, 2> BackgroundBuild::expand(SplitNode *node) {
+        if (node == nullptr) {
+            return {_tree.getRootNode(), nullptr};
+        }
+        return {node->getChildNode(0), node->getChildNode(1)};
+    }
+
+    void BackgroundBuild::report(const BuildProgress &progress, const size_t number) {
+        std::lock_guard lock{_progressMutex};
+        if (!_progress || number <= _lastReported) {
+            return;
+        }
+        _lastReported = number;
+        _progress(progress);
+    }
+
+    void BackgroundBuild::fail(std::exception_ptr exception) {
+        if (!_exception) {
+            _exception = std::move(exception);
+        }
+        _cancelled.store(true, std::memory_order_relaxed);
+        _changed.notify_all();
+    }
+} // namespace kdtree
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "KDTree/tree/SplitNode.h"
+#include "KDTree/tree/TreeNode.h"
+
+namespace kdtree {
+    //forward declaration
+    class KDTree;
+
+    /**
+     * The state of a {@link BackgroundBuild} passed to its progress callback.
+     */
+    struct BuildProgress {
+        /**
+         * The number of nodes found built so far, including the nodes built by queries.
+         */
+        size_t builtNodes;
+        /**
+         * The number of SplitNodes waiting for their children to be built. Grows while the build proceeds, as every built SplitNode adds its children.
+         */
+        size_t pendingNodes;
+        /**
+         * Set once the whole tree has been built and frozen, reported exactly once.
+         */
+        bool finished;
+    };
+
+    /**
+     * Builds the nodes of a lazily built KDTree on a pool of background threads while queries are answered concurrently.
+     * The pool expands the frontier of the built tree breadth-first. SplitNodes at which a query reaches the frontier are reported through {@link prioritize}
+     * and their subtrees are built depth-first before the remaining frontier, so the build follows the regions the rays actually hit.
+     * Once every node has been built the tree is frozen ({@link KDTree::prebuildTree}).
+     */
+    class BackgroundBuild {
+    public:
+        /**
+         * Called after each node expanded by the pool and once more after the tree has been frozen. The calls are serialized but made from the pool's threads,
+         * the callback may call {@link cancel} but not {@link wait}. An exception thrown by the callback aborts the build.
+         */
+        using ProgressCallback = std::function<void(const BuildProgress &)>;
+
+    private:
+        /**
+         * The tree to build.
+         */
+        KDTree &_tree;
+
+        /**
+         * The progress callback, may be empty.
+         */
+        const ProgressCallback _progress;
+
+        /**
+         * Protects the queues, the node states and the counters.
+         */
+        std::mutex _mutex;
+
+        /**
+         * Serializes the calls of the progress callback, which are made without holding _mutex.
+         */
+        std::mutex _progressMutex;
+
+        /**
+         * Signals changes of the queues, the number of active threads and the cancellation.
+         */
+        std::condition_variable _changed;
+
+        /**
+         * SplitNodes reached by queries and their descendants, expanded last in first out so that a hot subtree is completed before the next one.
+         */
+        std::vector<SplitNode *> _hotNodes;
+
+        /**
+         * The remaining frontier in breadth-first order. nullptr stands for the root, which is built by the pool as well.
+         */
+        std::deque<SplitNode *> _coldNodes;
+
+        /**
+         * The SplitNodes that have been queued, mapped to whether their children have been built. A node may be queued in both queues, it is expanded once.
+         */
+        std::unordered_map<const SplitNode *, bool> _expanded;
+
+        /**
+         * The number of queued SplitNodes whose children have not been built yet.
+         */
+        size_t _pendingNodes{0};
+
+        /**
+         * The number of threads currently expanding a node.
+         */
+        size_t _activeThreads{0};
+
+        /**
+         * The number of nodes found built so far.
+         */
+        size_t _builtNodes{0};
+
+        /**
+         * The number of progress states taken so far, numbering them in the order of the build.
+         */
+        size_t _progressCount{0};
+
+        /**
+         * The number of the last state passed to the callback. Only accessed while holding _progressMutex.
+         */
+        size_t _lastReported{0};
+
+        /**
+         * Set if the build has been cancelled or failed, the pool threads then stop as soon as they finished their current node.
+         */
+        std::atomic_bool _cancelled{false};
+
+        /**
+         * Set by the thread that found the tree complete and freezes it, the other threads stop.
+         */
+        bool _completed{false};
+
+        /**
+         * The first exception thrown by the tree building, rethrown by {@link wait}.
+         */
+        std::exception_ptr _exception;
+
+        /**
+         * Serializes the joining of the pool threads.
+         */
+        std::mutex _joinMutex;
+
+        /**
+         * The pool. Declared last, so that all other members are initialized before the threads start.
+         */
+        std::vector<std::thread> _threads;
+
+    public:
+        /**
+         * Starts building the tree in the background and returns right away.
+         * @param tree The tree to build. Has to outlive this object.
+         * @param threadCount The number of threads of the pool, 0 for the number of hardware threads.
+         * @param progress Called while the build proceeds. {@link ProgressCallback}
+         */
+        BackgroundBuild(KDTree &tree, size_t threadCount, ProgressCallback progress);
+
+        BackgroundBuild(const BackgroundBuild &) = delete;
+
+        BackgroundBuild &operator=(const BackgroundBuild &) = delete;
+
+        /**
+         * Cancels the build and waits for the pool threads to finish their current node.
+         */
+        ~BackgroundBuild();
+
+        /**
+         * Moves a SplitNode reached by a query to the front of the build, unless its children have already been built.
+         * @param node The node at which a query reached the unbuilt part of the tree.
+         */
+        void prioritize(SplitNode *node);
+
+        /**
+         * Stops the build after the nodes currently under construction. The nodes built so far remain in the tree, the rest is built lazily by the queries.
+         */
+        void cancel();
+
+        /**
+         * Blocks until the tree has been built and frozen or the build has been cancelled.
+         * @throws the exception that aborted the build, if any.
+         */
+        void wait();
+
+    private:
+        /**
+         * The loop of a pool thread: takes the next node from the queues and builds its children until the tree is complete or the build is cancelled.
+         */
+        void work();
+
+        /**
+         * Builds the children of a node.
+         * @param node The node to expand, nullptr for building the root.
+         * @return the built nodes.
+         */
+        std::array<TreeNode *, 2> expand(SplitNode *node);
+
+        /**
+         * Calls the progress callback with the given state, if there is one. A state older than the last reported one is dropped, so the callback observes the build in order.
+         * @param progress The state to report.
+         * @param number The number of the state, taken while holding _mutex.
+         */
+        void report(const BuildProgress &progress, size_t number);
+
+        /**
+         * Records the first error and cancels the build. Requires holding _mutex.
+         * @param exception The error that aborted the build.
+         */
+        void fail(std::exception_ptr exception);
+    };
+} // namespace kdtree
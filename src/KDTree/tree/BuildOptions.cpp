@@ -0,0 +1,90 @@
+#include "KDTree/tree/BuildOptions.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "KDTree/tree/FlatTree.h"
+#include "KDTree/tree/KDTree.h"
+
+namespace kdtree {
+    void BuildOptions::validate() const {
+        if (!std::isfinite(traverseStepCost) || traverseStepCost < 0.0) {
+            throw std::invalid_argument("The traverse step cost must be finite and not negative.");
+        }
+        if (!std::isfinite(triangleIntersectionCost) || triangleIntersectionCost <= 0.0) {
+            throw std::invalid_argument("The triangle intersection cost must be finite and positive.");
+        }
+        if (maxDepth > MAX_RECURSION_DEPTH) {
+            throw std::invalid_argument("The maximal depth must not exceed " + std::to_string(MAX_RECURSION_DEPTH) + ".");
+        }
+        if (!(emptySpaceBonus >= 0.0 && emptySpaceBonus < 1.0)) {
+            throw std::invalid_argument("The empty space bonus must lie in the range [0, 1).");
+        }
+        if (!(emptyCutoffThreshold >= 0.0 && emptyCutoffThreshold <= 1.0)) {
+            throw std::invalid_argument("The empty cutoff threshold must lie in the range [0, 1].");
+        }
+    }
+
+    BuildOptions BuildOptions::autoTune(const std::vector<Array3> &vertices, const std::vector<IndexArray3> &faces) {
+        using namespace util;
+        if (faces.empty()) {
+            return {};
+        }
+        //every n-th face, so that the sample covers the whole polyhedron
+        const size_t stride{(faces.size() + AUTO_TUNE_FACES - 1) / AUTO_TUNE_FACES};
+        std::vector<IndexArray3> sampledFaces{};
+        sampledFaces.reserve(faces.size() / stride + 1);
+        for (size_t i = 0; i < faces.size(); i += stride) {
+            sampledFaces.push_back(faces[i]);
+        }
+        KDTree tree{vertices, sampledFaces};
+        const Box boundingBox{Box::getBoundingBox(vertices)};
+        const FlatTree flatTree{tree.getRootNode(), boundingBox, vertices, sampledFaces};
+        //rays from points around the polyhedron to random points on its faces, so that they hit the polyhedron like the rays of typical queries
+        const Array3 center{(boundingBox.minPoint + boundingBox.maxPoint) * 0.5};
+        const double radius{std::sqrt(dot(boundingBox.maxPoint - center, boundingBox.maxPoint - center)) * 2.0};
+        std::mt19937 generator{AUTO_TUNE_RAYS};
+        std::normal_distribution<double> normal{};
+        std::uniform_real_distribution<double> uniform{};
+        std::uniform_int_distribution<size_t> faceDistribution{0, sampledFaces.size() - 1};
+        std::vector<Array3> origins{};
+        std::vector<Array3> rays{};
+        origins.reserve(AUTO_TUNE_RAYS);
+        rays.reserve(AUTO_TUNE_RAYS);
+        for (size_t i = 0; i < AUTO_TUNE_RAYS; ++i) {
+            Array3 direction{normal(generator), normal(generator), normal(generator)};
+            direction = direction / std::max(std::sqrt(dot(direction, direction)), EPSILON_ZERO_OFFSET);
+            const IndexArray3 &face{sampledFaces[faceDistribution(generator)]};
+            double a{uniform(generator)};
+            double b{uniform(generator)};
+            if (a + b > 1.0) {
+                a = 1.0 - a;
+                b = 1.0 - b;
+            }
+            const Array3 target{vertices[face[0]] * (1.0 - a - b) + vertices[face[1]] * a + vertices[face[2]] * b};
+            origins.push_back(center + direction * radius);
+            rays.push_back(target - origins.back());
+        }
+        //the fastest run is the one least disturbed by other processes
+        double stepCost{std::numeric_limits<double>::infinity()};
+        double triangleCost{std::numeric_limits<double>::infinity()};
+        for (size_t repetition = 0; repetition < AUTO_TUNE_REPETITIONS; ++repetition) {
+            const auto [measuredStepCost, measuredTriangleCost] = flatTree.measureCosts(origins, rays);
+            stepCost = std::min(stepCost, measuredStepCost);
+            triangleCost = std::min(triangleCost, measuredTriangleCost);
+        }
+        BuildOptions options{};
+        //the tree of the sample may consist of a single leaf or the timer resolution may be too coarse -> keep the defaults
+        if (stepCost <= 0.0 || triangleCost <= 0.0) {
+            return options;
+        }
+        options.traverseStepCost = std::clamp(stepCost / triangleCost, MIN_COST_RATIO, MAX_COST_RATIO);
+        options.triangleIntersectionCost = 1.0;
+        return options;
+    }
+} // namespace kdtree
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "KDTree/tree/KdDefinitions.h"
+
+/**
+ * Upper bound of {@link kdtree::BuildOptions::maxDepth}. The traversals use stacks of fixed size, which rely on this bound.
+ */
+constexpr uint8_t MAX_RECURSION_DEPTH{64};
+
+namespace kdtree {
+    /**
+     * Parameters of the Surface Area Heuristic (SAH) and the termination criteria used while building a KDTree. The defaults reproduce the tree built without options.
+     * Only the ratio of the two cost constants influences the shape of the tree, {@link autoTune} derives it from measurements on the current machine.
+     */
+    struct BuildOptions {
+        /**
+         * The cost of traversing the KDTree by one step.
+         */
+        double traverseStepCost{1.0};
+        /**
+         * The cost of intersecting a ray and a single triangle.
+         */
+        double triangleIntersectionCost{1.0};
+        /**
+         * Nodes at this depth become leaves. At most {@link MAX_RECURSION_DEPTH}.
+         */
+        size_t maxDepth{MAX_RECURSION_DEPTH};
+        /**
+         * Nodes bound to at most this many faces become leaves without searching a split plane. With 0 only the cost function decides.
+         */
+        size_t minLeafSize{0};
+        /**
+         * The fraction by which the cost of a split is reduced if one of the child boxes is empty, which favors cutting off empty space. In the range [0, 1).
+         */
+        double emptySpaceBonus{0.2};
+        /**
+         * Scales the emptySpaceBonus by the fraction of the node's extent along the split axis that is cut off, so that thin slices of empty space are not rewarded like large ones.
+         */
+        bool scaleEmptySpaceBonus{false};
+        /**
+         * Empty space between the faces of a node and one side of its bounding box is cut off by a split with an empty child, if it spans more than this fraction of the box's extent.
+         * Checked before searching a plane with the cost function. 0 disables the cutoff, otherwise in the range (0, 1].
+         */
+        double emptyCutoffThreshold{0.0};
+        /**
+         * Split nodes keep the bounding box of their faces, so that the lazy traversal culls rays passing only empty space of a node without visiting its children.
+         */
+        bool tightBounds{false};
+
+        /**
+         * Checks that the options describe a valid cost model.
+         * @throws std::invalid_argument if a cost is negative or not finite, the triangle intersection cost is 0, maxDepth exceeds {@link MAX_RECURSION_DEPTH}, the emptySpaceBonus lies outside [0, 1)
+         * or the emptyCutoffThreshold outside [0, 1].
+         */
+        void validate() const;
+
+        /**
+         * Derives the cost constants from the hardware: builds a tree for (a sample of) the given polyhedron, then times the traversal steps and the ray/triangle tests of queries on it.
+         * The triangle intersection cost is normalized to 1, the remaining options keep their defaults. The duration is dominated by building the tree of the sample, the result varies slightly between runs.
+         * @param vertices The vertex coordinates of the polyhedron.
+         * @param faces The faces of the polyhedron with a face being a triplet of vertex indices.
+         * @return the tuned options.
+         */
+        static BuildOptions autoTune(const std::vector<Array3> &vertices, const std::vector<IndexArray3> &faces);
+
+    private:
+        /**
+         * The polyhedron is reduced to at most this many faces for {@link autoTune}, so that the measurement is fast for large polyhedra.
+         */
+        static constexpr size_t AUTO_TUNE_FACES{1 << 14};
+        /**
+         * The number of rays traced by {@link autoTune}.
+         */
+        static constexpr size_t AUTO_TUNE_RAYS{1 << 12};
+        /**
+         * The measurement is repeated this many times and the fastest run is kept to reduce the noise.
+         */
+        static constexpr size_t AUTO_TUNE_REPETITIONS{3};
+        /**
+         * Bounds of the tuned ratio of traversal step cost to triangle intersection cost, guarding against unreliable measurements.
+         */
+        static constexpr double MIN_COST_RATIO{0.01};
+        static constexpr double MAX_COST_RATIO{100.0};
+    };
+
+    /**
+     * The options used if none are given.
+     */
+    inline const BuildOptions DEFAULT_BUILD_OPTIONS{};
+} // namespace kdtree
@@ -0,0 +1,75 @@
+#include "KDTree/tree/FaceMarker.h"
+
+#include <algorithm>
+
+namespace kdtree {
+    namespace {
+        /**
+         * The markers of the calling thread that are currently not leased.
+         */
+        std::vector<std::unique_ptr<FaceMarker> > &threadPool() {
+            thread_local std::vector<std::unique_ptr<FaceMarker> > pool{};
+            return pool;
+        }
+    }
+
+    FaceMarker::Lease::Lease(std::unique_ptr<FaceMarker> marker)
+        : _marker{std::move(marker)} {
+    }
+
+    FaceMarker::Lease::~Lease() {
+        threadPool().push_back(std::move(_marker));
+    }
+
+    FaceMarker &FaceMarker::Lease::operator*() const {
+        return *_marker;
+    }
+
+    FaceMarker *FaceMarker::Lease::operator->() const {
+        return _marker.get();
+    }
+
+    FaceMarker::Lease FaceMarker::acquire() {
+        auto &pool{threadPool()};
+        std::unique_ptr<FaceMarker> marker{};
+        if (pool.empty()) {
+            marker = std::make_unique<FaceMarker>();
+        } else {
+            marker = std::move(pool.back());
+            pool.pop_back();
+        }
+        marker->clear();
+        return Lease{std::move(marker)};
+    }
+
+    void FaceMarker::clear() {
+        //the stamps would become ambiguous after an overflow -> invalidate them once explicitly
+        if (++_generation == 0) {
+            std::fill(_stamps.begin(), _stamps.end(), 0);
+            _generation = 1;
+        }
+    }
+
+    uint8_t FaceMarker::get(const size_t faceIndex) const {
+        return faceIndex < _stamps.size() && _stamps[faceIndex] == _generation ? _values[faceIndex] : 0;
+    }
+
+    void FaceMarker::set(const size_t faceIndex, const uint8_t value) {
+        if (faceIndex >= _stamps.size()) {
+            //grow geometrically, the table usually reaches the polyhedron's face count during the first split
+            const size_t size{std::max(faceIndex + 1, 2 * _stamps.size())};
+            _stamps.resize(size, 0);
+            _values.resize(size, 0);
+        }
+        _stamps[faceIndex] = _generation;
+        _values[faceIndex] = value;
+    }
+
+    bool FaceMarker::insert(const size_t faceIndex, const uint8_t value) {
+        if (get(faceIndex) != 0) {
+            return false;
+        }
+        set(faceIndex, value);
+        return true;
+    }
+} // namespace kdtree
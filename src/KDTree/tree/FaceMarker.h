@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace kdtree {
+
+    /**
+     * Dense table assigning a small value to each face of a polyhedron, indexed by the face index. Used to classify and deduplicate faces while splitting nodes instead of hash containers.
+     * Each entry is stamped with the generation it was written in, so that {@link clear} invalidates all entries in O(1) and the memory is reused for the next node.
+     * A marker must not be used by several threads at the same time.
+     */
+    class FaceMarker {
+    public:
+        /**
+         * Exclusive access to a cleared marker of the calling thread. The marker is returned to the thread's pool on destruction.
+         */
+        class Lease {
+        public:
+            explicit Lease(std::unique_ptr<FaceMarker> marker);
+
+            Lease(const Lease &) = delete;
+
+            Lease &operator=(const Lease &) = delete;
+
+            ~Lease();
+
+            FaceMarker &operator*() const;
+
+            FaceMarker *operator->() const;
+
+        private:
+            std::unique_ptr<FaceMarker> _marker;
+        };
+
+        /**
+         * Takes a marker from the pool of the calling thread and clears it. A work stealing scheduler may run other tasks on the calling thread while it waits inside a parallel algorithm,
+         * those tasks obtain a different marker, so that a marker can be held across parallel algorithms.
+         * @return the lease of the marker, which has to be destroyed on the calling thread.
+         */
+        static Lease acquire();
+
+        /**
+         * Invalidates all entries, afterward each face holds the value 0.
+         */
+        void clear();
+
+        /**
+         * Returns the value of a face.
+         * @param faceIndex The index of the face.
+         * @return the value set since the last {@link clear}, 0 otherwise.
+         */
+        [[nodiscard]] uint8_t get(size_t faceIndex) const;
+
+        /**
+         * Sets the value of a face, the table grows if needed.
+         * @param faceIndex The index of the face.
+         * @param value The value to store.
+         */
+        void set(size_t faceIndex, uint8_t value);
+
+        /**
+         * Marks a face with a value unless it has been marked before.
+         * @param faceIndex The index of the face.
+         * @param value The value to store, must not be 0.
+         * @return true if the face had not been marked since the last {@link clear}.
+         */
+        bool insert(size_t faceIndex, uint8_t value = 1);
+
+    private:
+        /**
+         * The generation each entry was written in, entries of older generations are invalid.
+         */
+        std::vector<uint32_t> _stamps{};
+
+        /**
+         * The values of the faces.
+         */
+        std::vector<uint8_t> _values{};
+
+        /**
+         * The current generation, 0 is reserved for entries that have never been written.
+         */
+        uint32_t _generation{1};
+    };
+} // namespace kdtree
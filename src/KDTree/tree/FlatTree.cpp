@@ -0,0 +1,431 @@
+#include "KDTree/tree/FlatTree.h"
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace kdtree {
+    namespace {
+        /**
+         * Identifies a binary image of a FlatTree.
+         */
+        constexpr std::array<char, 8> IMAGE_MAGIC{'K', 'D', 'T', 'R', 'E', 'E', '\0', '\0'};
+
+        /**
+         * Written in the byte order of the writing machine, so that images of machines with a different byte order are rejected.
+         */
+        constexpr uint32_t BYTE_ORDER_MARK{0x01020304};
+
+        /**
+         * The header of a binary image of a FlatTree. All offsets are relative to the beginning of the image.
+         */
+        struct ImageHeader {
+            std::array<char, 8> magic;
+            uint32_t version;
+            uint32_t byteOrder;
+            uint32_t nodeSize;
+            uint32_t blockSize;
+            uint64_t packetSize;
+            uint64_t meshHash;
+            uint64_t vertexCount;
+            uint64_t faceCount;
+            std::array<Array3, 2> boundingBox;
+            uint64_t nodeCount;
+            uint64_t nodeOffset;
+            uint64_t blockCount;
+            uint64_t blockOffset;
+        };
+    } // namespace
+} // namespace kdtree
+
+namespace kdtree {
+    FlatTree::FlatTree(TreeNode *rootNode, const Box &boundingBox,
+                       const std::vector<Array3> &vertices, const std::vector<IndexArray3> &faces)
+        : _vertices{vertices}, _faces{faces}, _boundingBox{boundingBox} {
+        std::vector<FlatNode> nodes{};
+        std::vector<TriangleBlock> triangles{};
+        //iterative depth first conversion, the stack holds the nodes to convert and the index of the parent whose greater child offset has to be set
+        std::vector<std::pair<TreeNode *, std::optional<uint32_t> > > stack{};
+        stack.emplace_back(rootNode, std::nullopt);
+        while (!stack.empty()) {
+            const auto [node, parent] = stack.back();
+            stack.pop_back();
+            const auto index = static_cast<uint32_t>(nodes.size());
+            if (parent.has_value()) {
+                nodes[parent.value()].offset = index;
+            }
+            if (const auto split = dynamic_cast<SplitNode *>(node)) {
+                const Plane &plane{split->getPlane()};
+                nodes.push_back({plane.axisCoordinate, 0, static_cast<uint32_t>(plane.orientation)});
+                //push the greater child first, so that the lesser child is placed directly behind its parent
+                stack.emplace_back(split->getChildNode(1), index);
+                stack.emplace_back(split->getChildNode(0), std::nullopt);
+            } else if (const auto leaf = dynamic_cast<LeafNode *>(node)) {
+                const TriangleIndexVector &boundFaces{leaf->getBoundFaces()};
+                nodes.push_back({0.0, static_cast<uint32_t>(triangles.size()),
+                                  static_cast<uint32_t>(boundFaces.size()) << 2 | FlatNode::LEAF});
+                //zero initialized lanes at the end of the last block form degenerate triangles
+                const size_t firstBlock{triangles.size()};
+                triangles.resize(firstBlock + (boundFaces.size() + PACKET_SIZE - 1) / PACKET_SIZE, TriangleBlock{});
+                for (size_t i = 0; i < boundFaces.size(); ++i) {
+                    using namespace util;
+                    TriangleBlock &block{triangles[firstBlock + i / PACKET_SIZE]};
+                    const size_t lane{i % PACKET_SIZE};
+                    const IndexArray3 &face{_faces[boundFaces[i]]};
+                    const Array3 &vertex0{_vertices[face[0]]};
+                    const Array3 edge1{_vertices[face[1]] - vertex0};
+                    const Array3 edge2{_vertices[face[2]] - vertex0};
+                    for (size_t axis = 0; axis < DIMENSIONS; ++axis) {
+                        block.vertex0[axis][lane] = vertex0[axis];
+                        block.edge1[axis][lane] = edge1[axis];
+                        block.edge2[axis][lane] = edge2[axis];
+                    }
+                    block.faceIndex[lane] = static_cast<uint32_t>(boundFaces[i]);
+                }
+            }
+        }
+        nodes.shrink_to_fit();
+        triangles.shrink_to_fit();
+        auto storage{std::make_shared<std::pair<std::vector<FlatNode>, std::vector<TriangleBlock> > >(std::move(nodes), std::move(triangles))};
+        _nodes = storage->first.data();
+        _nodeCount = storage->first.size();
+        _triangles = storage->second.data();
+        _blockCount = storage->second.size();
+        _storage = std::move(storage);
+    }
+
+    FlatTree::FlatTree(const std::vector<Array3> &vertices, const std::vector<IndexArray3> &faces, const Box &boundingBox)
+        : _vertices{vertices}, _faces{faces}, _boundingBox{boundingBox} {
+    }
+
+    std::unique_ptr<FlatTree> FlatTree::load(util::MappedFile &&image, const std::vector<Array3> &vertices,
+                                             const std::vector<IndexArray3> &faces) {
+        ImageHeader header{};
+        if (image.size() < sizeof(ImageHeader)) {
+            throw std::runtime_error("The image is too small to contain a KDTree.");
+        }
+        std::memcpy(&header, image.data(), sizeof(ImageHeader));
+        if (header.magic != IMAGE_MAGIC) {
+            throw std::runtime_error("The image does not contain a KDTree.");
+        }
+        if (header.version != FORMAT_VERSION) {
+            throw std::runtime_error("The image has been written in version " + std::to_string(header.version) +
+                                     " of the format, expected version " + std::to_string(FORMAT_VERSION) + ".");
+        }
+        //the nodes and blocks are used in place -> the image must have been written with the same memory layout
+        if (header.byteOrder != BYTE_ORDER_MARK || header.nodeSize != sizeof(FlatNode) ||
+            header.blockSize != sizeof(TriangleBlock) || header.packetSize != PACKET_SIZE) {
+            throw std::runtime_error("The image has been written on a platform with a different memory layout.");
+        }
+        if (header.vertexCount != vertices.size() || header.faceCount != faces.size() ||
+            header.meshHash != meshHash(vertices, faces)) {
+            throw std::invalid_argument("The image belongs to a different polyhedron.");
+        }
+        //the offsets must lie inside the image and the arrays must not overflow it
+        const auto fits = [&image](const uint64_t offset, const uint64_t count, const size_t elementSize) {
+            return offset % IMAGE_ALIGNMENT == 0 && offset <= image.size() &&
+                   count <= (image.size() - offset) / elementSize;
+        };
+        if (header.nodeCount == 0 || !fits(header.nodeOffset, header.nodeCount, sizeof(FlatNode)) ||
+            !fits(header.blockOffset, header.blockCount, sizeof(TriangleBlock))) {
+            throw std::runtime_error("The image is truncated or malformed.");
+        }
+        Box boundingBox{std::make_pair(header.boundingBox[0], header.boundingBox[1])};
+        std::unique_ptr<FlatTree> tree{new FlatTree{vertices, faces, boundingBox}};
+        auto storage{std::make_shared<util::MappedFile>(std::move(image))};
+        tree->_nodes = reinterpret_cast<const FlatNode *>(storage->data() + header.nodeOffset);
+        tree->_nodeCount = header.nodeCount;
+        tree->_triangles = reinterpret_cast<const TriangleBlock *>(storage->data() + header.blockOffset);
+        tree->_blockCount = header.blockCount;
+        tree->_storage = std::move(storage);
+        tree->validate();
+        return tree;
+    }
+
+    void FlatTree::save(std::ostream &stream) const {
+        const auto align = [](const uint64_t offset) {
+            return (offset + IMAGE_ALIGNMENT - 1) / IMAGE_ALIGNMENT * IMAGE_ALIGNMENT;
+        };
+        ImageHeader header{};
+        header.magic = IMAGE_MAGIC;
+        header.version = FORMAT_VERSION;
+        header.byteOrder = BYTE_ORDER_MARK;
+        header.nodeSize = sizeof(FlatNode);
+        header.blockSize = sizeof(TriangleBlock);
+        header.packetSize = PACKET_SIZE;
+        header.meshHash = meshHash(_vertices, _faces);
+        header.vertexCount = _vertices.size();
+        header.faceCount = _faces.size();
+        header.boundingBox = {_boundingBox.minPoint, _boundingBox.maxPoint};
+        header.nodeCount = _nodeCount;
+        header.nodeOffset = align(sizeof(ImageHeader));
+        header.blockCount = _blockCount;
+        header.blockOffset = align(header.nodeOffset + _nodeCount * sizeof(FlatNode));
+        const std::array<char, IMAGE_ALIGNMENT> padding{};
+        const auto write = [&stream](const void *data, const size_t size) {
+            stream.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+        };
+        write(&header, sizeof(ImageHeader));
+        write(padding.data(), header.nodeOffset - sizeof(ImageHeader));
+        write(_nodes, _nodeCount * sizeof(FlatNode));
+        write(padding.data(), header.blockOffset - header.nodeOffset - _nodeCount * sizeof(FlatNode));
+        write(_triangles, _blockCount * sizeof(TriangleBlock));
+        if (!stream) {
+            throw std::runtime_error("The KDTree could not be written.");
+        }
+    }
+
+    uint64_t FlatTree::meshHash(const std::vector<Array3> &vertices, const std::vector<IndexArray3> &faces) {
+        //64 bit FNV-1a over the bytes of the counts, the vertex coordinates and the vertex indices of the faces
+        constexpr uint64_t offsetBasis{14695981039346656037ull};
+        constexpr uint64_t prime{1099511628211ull};
+        uint64_t hash{offsetBasis};
+        const auto hashValue = [&hash](const auto value) {
+            std::array<unsigned char, sizeof(value)> bytes{};
+            std::memcpy(bytes.data(), &value, sizeof(value));
+            for (const unsigned char byte: bytes) {
+                hash = (hash ^ byte) * prime;
+            }
+        };
+        hashValue(static_cast<uint64_t>(vertices.size()));
+        hashValue(static_cast<uint64_t>(faces.size()));
+        for (const Array3 &vertex: vertices) {
+            for (const double coordinate: vertex) {
+                hashValue(coordinate);
+            }
+        }
+        for (const IndexArray3 &face: faces) {
+            for (const size_t vertexIndex: face) {
+                hashValue(static_cast<uint64_t>(vertexIndex));
+            }
+        }
+        return hash;
+    }
+
+    void FlatTree::validate() const {
+        //the children of a node are located behind it -> the depths are known once a node is reached
+        std::vector<uint8_t> depth(_nodeCount, 0);
+        for (size_t index = 0; index < _nodeCount; ++index) {
+            const FlatNode &node{_nodes[index]};
+            if (node.isLeaf()) {
+                const uint64_t blocks{(static_cast<uint64_t>(node.faceCount()) + PACKET_SIZE - 1) / PACKET_SIZE};
+                if (node.offset > _blockCount || blocks > _blockCount - node.offset) {
+                    throw std::runtime_error("A leaf of the image references triangles outside of the image.");
+                }
+                continue;
+            }
+            if (node.offset <= index + 1 || node.offset >= _nodeCount || index + 1 >= _nodeCount) {
+                throw std::runtime_error("A split node of the image references nodes outside of the image.");
+            }
+            if (depth[index] >= MAX_RECURSION_DEPTH) {
+                throw std::runtime_error("The tree of the image exceeds the maximal depth.");
+            }
+            //a node referenced by several split nodes keeps the largest depth
+            depth[index + 1] = std::max<uint8_t>(depth[index + 1], depth[index] + 1);
+            depth[node.offset] = std::max<uint8_t>(depth[node.offset], depth[index] + 1);
+        }
+        for (size_t block = 0; block < _blockCount; ++block) {
+            for (const uint32_t faceIndex: _triangles[block].faceIndex) {
+                //unused lanes are zero initialized
+                if (faceIndex >= _faces.size() && faceIndex != 0) {
+                    throw std::runtime_error("A triangle of the image references a face outside of the polyhedron.");
+                }
+            }
+        }
+    }
+
+    void FlatTree::getFaceIntersections(const Array3 &origin, const Array3 &ray,
+                                        std::vector<Array3> &intersections) const {
+        using namespace util;
+        //calculate inverse ray direction
+        const Array3 inverseRay{1. / ray[0], 1. / ray[1], 1. / ray[2]};
+        const BatchArray3 rayOrigin{broadcast(origin)};
+        const BatchArray3 rayVector{broadcast(ray)};
+        constexpr double unlimited{std::numeric_limits<double>::infinity()};
+        traverse(origin, inverseRay, unlimited, [this, &origin, &ray, &rayOrigin, &rayVector, &intersections](const FlatNode &leaf) {
+            forEachBlock(leaf, [&origin, &ray, &rayOrigin, &rayVector, &intersections](const TriangleBlock &block, size_t) {
+                const auto [hit, t] = intersect(block, rayOrigin, rayVector);
+                forEachHit(hit, t, [&origin, &ray, &intersections](size_t, const double tHit) {
+                    intersections.push_back(origin + ray * tHit);
+                });
+            });
+            return unlimited;
+        });
+    }
+
+    void FlatTree::getFaceIntersections(const std::array<Array3, PACKET_SIZE> &origins,
+                                        const std::array<Array3, PACKET_SIZE> &rays,
+                                        std::array<std::vector<Array3>, PACKET_SIZE> &intersections) const {
+        using namespace util;
+        //transpose the rays into one SIMD register per coordinate
+        BatchArray3 origin{};
+        BatchArray3 ray{};
+        BatchArray3 inverseRay{};
+        for (size_t axis = 0; axis < DIMENSIONS; ++axis) {
+            std::array<double, PACKET_SIZE> originLanes{};
+            std::array<double, PACKET_SIZE> rayLanes{};
+            for (size_t lane = 0; lane < PACKET_SIZE; ++lane) {
+                originLanes[lane] = origins[lane][axis];
+                rayLanes[lane] = rays[lane][axis];
+            }
+            origin[axis] = DoubleBatch::load_unaligned(originLanes.data());
+            ray[axis] = DoubleBatch::load_unaligned(rayLanes.data());
+            inverseRay[axis] = DoubleBatch(1.) / ray[axis];
+            //the rays disagree on the traversal order -> fall back to single ray traversal
+            if (!xsimd::all(inverseRay[axis] > DoubleBatch(0.0)) && !xsimd::all(inverseRay[axis] < DoubleBatch(0.0))) {
+                for (size_t lane = 0; lane < PACKET_SIZE; ++lane) {
+                    getFaceIntersections(origins[lane], rays[lane], intersections[lane]);
+                }
+                return;
+            }
+        }
+        traversePacket(origin, inverseRay, [this, &origins, &rays, &origin, &ray, &intersections](
+                   const FlatNode &leaf, const BoolBatch &active) {
+            forEachBlock(leaf, [&origins, &rays, &origin, &ray, &active, &intersections](
+                       const TriangleBlock &block, const size_t triangleCount) {
+                for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+                    const auto [hit, t] = intersect(block, triangle, origin, ray);
+                    //the intersection points are calculated like in the scalar version, so that they are identical
+                    forEachHit(hit & active, t, [&origins, &rays, &intersections](const size_t lane, const double tHit) {
+                        intersections[lane].push_back(origins[lane] + rays[lane] * tHit);
+                    });
+                }
+            });
+        });
+    }
+
+    size_t FlatTree::countCrossings(const Array3 &origin, const Array3 &ray, std::vector<uint32_t> &crossedFaces) const {
+        const Array3 inverseRay{1. / ray[0], 1. / ray[1], 1. / ray[2]};
+        const ShearedRay shearedRay{LeafNode::shearRay(origin, ray)};
+        //a face bound to several leaves is tested once per leaf -> remember the crossed faces
+        crossedFaces.clear();
+        constexpr double unlimited{std::numeric_limits<double>::infinity()};
+        traverse(origin, inverseRay, unlimited, [this, &shearedRay, &crossedFaces](const FlatNode &leaf) {
+            forEachBlock(leaf, [this, &shearedRay, &crossedFaces](const TriangleBlock &block, const size_t triangleCount) {
+                for (size_t lane = 0; lane < triangleCount; ++lane) {
+                    const uint32_t faceIndex{block.faceIndex[lane]};
+                    const IndexArray3 &face{_faces[faceIndex]};
+                    const Array3Triplet triangle{_vertices[face[0]], _vertices[face[1]], _vertices[face[2]]};
+                    if (LeafNode::watertightRayTriangleIntersection(shearedRay, triangle, face).has_value() &&
+                        std::find(crossedFaces.cbegin(), crossedFaces.cend(), faceIndex) == crossedFaces.cend()) {
+                        crossedFaces.push_back(faceIndex);
+                    }
+                }
+            });
+            return unlimited;
+        });
+        return crossedFaces.size();
+    }
+
+    std::optional<Array3> FlatTree::closestIntersection(const Array3 &origin, const Array3 &ray) const {
+        using namespace util;
+        const Array3 inverseRay{1. / ray[0], 1. / ray[1], 1. / ray[2]};
+        const BatchArray3 rayOrigin{broadcast(origin)};
+        const BatchArray3 rayVector{broadcast(ray)};
+        double closest{std::numeric_limits<double>::infinity()};
+        //leaves are visited front to back, so nodes starting behind the closest hit found so far are skipped
+        traverse(origin, inverseRay, closest, [this, &rayOrigin, &rayVector, &closest](const FlatNode &leaf) {
+            forEachBlock(leaf, [&rayOrigin, &rayVector, &closest](const TriangleBlock &block, size_t) {
+                const auto [hit, t] = intersect(block, rayOrigin, rayVector);
+                forEachHit(hit, t, [&closest](size_t, const double tHit) {
+                    closest = std::min(closest, tHit);
+                });
+            });
+            return closest;
+        });
+        if (std::isinf(closest)) {
+            return std::nullopt;
+        }
+        return origin + ray * closest;
+    }
+
+    bool FlatTree::anyIntersection(const Array3 &origin, const Array3 &ray, const double tMax) const {
+        const Array3 inverseRay{1. / ray[0], 1. / ray[1], 1. / ray[2]};
+        const BatchArray3 rayOrigin{broadcast(origin)};
+        const BatchArray3 rayVector{broadcast(ray)};
+        bool hit{false};
+        traverse(origin, inverseRay, tMax, [this, &rayOrigin, &rayVector, tMax, &hit](const FlatNode &leaf) {
+            forEachBlock(leaf, [&rayOrigin, &rayVector, tMax, &hit](const TriangleBlock &block, size_t) {
+                if (!hit) {
+                    const auto [blockHit, t] = intersect(block, rayOrigin, rayVector);
+                    hit = xsimd::any(blockHit & (t < DoubleBatch(tMax)));
+                }
+            });
+            //a negative limit stops the traversal as soon as one hit has been found
+            return hit ? -1.0 : tMax;
+        });
+        return hit;
+    }
+
+    size_t FlatTree::size() const {
+        return _nodeCount;
+    }
+
+    std::pair<double, double> FlatTree::measureCosts(const std::vector<Array3> &origins,
+                                                     const std::vector<Array3> &rays) const {
+        using Clock = std::chrono::steady_clock;
+        constexpr double unlimited{std::numeric_limits<double>::infinity()};
+        //first pass: only traverse the tree and count the split nodes passed
+        size_t steps{0};
+        const Clock::time_point traversalStart{Clock::now()};
+        for (size_t i = 0; i < origins.size(); ++i) {
+            const Array3 inverseRay{1. / rays[i][0], 1. / rays[i][1], 1. / rays[i][2]};
+            traverse(origins[i], inverseRay, unlimited, [](const FlatNode &) {
+                return unlimited;
+            }, [&steps](const FlatNode &) {
+                ++steps;
+            });
+        }
+        const std::chrono::duration<double> traversalTime{Clock::now() - traversalStart};
+        //second pass: the same traversal testing the triangles of the visited leaves, the hits are counted so that the tests are not optimized away
+        size_t tests{0};
+        size_t hits{0};
+        const Clock::time_point queryStart{Clock::now()};
+        for (size_t i = 0; i < origins.size(); ++i) {
+            const Array3 inverseRay{1. / rays[i][0], 1. / rays[i][1], 1. / rays[i][2]};
+            const BatchArray3 rayOrigin{broadcast(origins[i])};
+            const BatchArray3 rayVector{broadcast(rays[i])};
+            traverse(origins[i], inverseRay, unlimited, [this, &rayOrigin, &rayVector, &tests, &hits](const FlatNode &leaf) {
+                forEachBlock(leaf, [&rayOrigin, &rayVector, &tests, &hits](const TriangleBlock &block, const size_t triangleCount) {
+                    const auto [hit, t] = intersect(block, rayOrigin, rayVector);
+                    forEachHit(hit, t, [&hits](size_t, double) {
+                        ++hits;
+                    });
+                    tests += triangleCount;
+                });
+                return unlimited;
+            });
+        }
+        const std::chrono::duration<double> queryTime{Clock::now() - queryStart};
+        volatile size_t hitSink{hits};
+        static_cast<void>(hitSink);
+        const double stepCost{steps == 0 ? 0.0 : traversalTime.count() / static_cast<double>(steps)};
+        const double triangleCost{
+            tests == 0 ? 0.0 : std::max(queryTime.count() - traversalTime.count(), 0.0) / static_cast<double>(tests)
+        };
+        return {stepCost, triangleCost};
+    }
+
+    std::pair<BoolBatch, DoubleBatch> FlatTree::intersect(const TriangleBlock &block, const BatchArray3 &origin,
+                                                          const BatchArray3 &ray) {
+        const auto load = [](const std::array<std::array<double, PACKET_SIZE>, DIMENSIONS> &coordinates) {
+            return BatchArray3{
+                DoubleBatch::load_unaligned(coordinates[0].data()), DoubleBatch::load_unaligned(coordinates[1].data()),
+                DoubleBatch::load_unaligned(coordinates[2].data())
+            };
+        };
+        return LeafNode::rayTriangleIntersection(origin, ray, load(block.vertex0), load(block.edge1), load(block.edge2));
+    }
+
+    std::pair<BoolBatch, DoubleBatch> FlatTree::intersect(const TriangleBlock &block, const size_t lane,
+                                                          const BatchArray3 &origin, const BatchArray3 &ray) {
+        const auto load = [lane](const std::array<std::array<double, PACKET_SIZE>, DIMENSIONS> &coordinates) {
+            return broadcast({coordinates[0][lane], coordinates[1][lane], coordinates[2][lane]});
+        };
+        return LeafNode::rayTriangleIntersection(origin, ray, load(block.vertex0), load(block.edge1), load(block.edge2));
+    }
+
+    BatchArray3 FlatTree::broadcast(const Array3 &vector) {
+        return {DoubleBatch(vector[0]), DoubleBatch(vector[1]), DoubleBatch(vector[2])};
+    }
+} // namespace kdtree
@@ -0,0 +1,440 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "KDTree/tree/KdDefinitions.h"
+#include "KDTree/tree/LeafNode.h"
+#include "KDTree/tree/SplitNode.h"
+#include "KDTree/tree/TreeNode.h"
+#include "KDTree/tree/TreeNodeFactory.h"
+#include "KDTree/util/MappedFile.h"
+
+namespace kdtree {
+
+    /**
+     * Compact node of a {@link FlatTree}. The nodes are stored in depth first order, thus the lesser child of a split node is always located directly after its parent.
+     */
+    struct FlatNode {
+        /**
+         * Value of the direction bits that marks a node as leaf. Split nodes store their split {@link Direction} there instead.
+         */
+        static constexpr uint32_t LEAF{3};
+
+        /**
+         * Split nodes: The coordinate of the split plane. Unused for leaves.
+         */
+        double axisCoordinate;
+        /**
+         * Split nodes: The index of the greater child node. Leaves: The position of the first {@link TriangleBlock} of the leaf in the {@link FlatTree}.
+         */
+        uint32_t offset;
+        /**
+         * The two lowest bits hold the split direction or {@link LEAF}. Leaves store the number of their bound faces in the remaining bits.
+         */
+        uint32_t flags;
+
+        [[nodiscard]] bool isLeaf() const {
+            return (flags & 3u) == LEAF;
+        }
+
+        [[nodiscard]] size_t axis() const {
+            return flags & 3u;
+        }
+
+        [[nodiscard]] uint32_t faceCount() const {
+            return flags >> 2;
+        }
+    };
+
+    /**
+     * Precomputed data of up to {@link PACKET_SIZE} triangles stored as structure of arrays, so that a ray can be tested against all of them with one SIMD instruction per step. Unused lanes hold degenerate triangles, which are never hit.
+     */
+    struct TriangleBlock {
+        /**
+         * The coordinates of the first vertex of each triangle.
+         */
+        std::array<std::array<double, PACKET_SIZE>, DIMENSIONS> vertex0;
+        /**
+         * The coordinates of the edge from the first to the second vertex of each triangle.
+         */
+        std::array<std::array<double, PACKET_SIZE>, DIMENSIONS> edge1;
+        /**
+         * The coordinates of the edge from the first to the third vertex of each triangle.
+         */
+        std::array<std::array<double, PACKET_SIZE>, DIMENSIONS> edge2;
+        /**
+         * The index of each triangle in the polyhedron's faces.
+         */
+        std::array<uint32_t, PACKET_SIZE> faceIndex;
+    };
+
+    /**
+     * Pointer free snapshot of a fully built KDTree. All nodes live in one contiguous array, so queries neither cast nodes, nor touch reference counts or allocate memory during traversal.
+     */
+    class FlatTree {
+        /**
+         * The polyhedron's vertices.
+         */
+        const std::vector<Array3> &_vertices;
+        /**
+         * The polyhedron's faces.
+         */
+        const std::vector<IndexArray3> &_faces;
+        /**
+         * The bounding box of the root node.
+         */
+        Box _boundingBox;
+        /**
+         * Owns the memory of the nodes and triangles: either the vectors filled by the conversion of a built tree or the file the tree has been loaded from.
+         */
+        std::shared_ptr<const void> _storage;
+        /**
+         * The nodes of the tree in depth first order, the root node is located at index 0.
+         */
+        const FlatNode *_nodes{nullptr};
+        /**
+         * The number of nodes.
+         */
+        size_t _nodeCount{0};
+        /**
+         * The triangles of all leaves. Each leaf references a contiguous range of this array.
+         */
+        const TriangleBlock *_triangles{nullptr};
+        /**
+         * The number of triangle blocks.
+         */
+        size_t _blockCount{0};
+
+    public:
+        /**
+         * Converts a built tree into its flat representation. Nodes that have not been built yet are built during conversion.
+         * @param rootNode The root node of the tree to convert.
+         * @param boundingBox The bounding box of the root node.
+         * @param vertices The polyhedron's vertices. Have to outlive this FlatTree.
+         * @param faces The polyhedron's faces. Have to outlive this FlatTree.
+         */
+        FlatTree(TreeNode *rootNode, const Box &boundingBox, const std::vector<Array3> &vertices,
+                 const std::vector<IndexArray3> &faces);
+
+        /**
+         * Creates a tree from the binary image written by {@link save}. The nodes and triangles are used in place, nothing is rebuilt.
+         * @param image The image, kept alive by the tree.
+         * @param vertices The polyhedron's vertices. Have to outlive this FlatTree.
+         * @param faces The polyhedron's faces. Have to outlive this FlatTree.
+         * @return the loaded tree.
+         * @throws std::runtime_error if the image is malformed, has been written by an incompatible version or on a platform with a different memory layout.
+         * @throws std::invalid_argument if the image belongs to a different polyhedron.
+         */
+        static std::unique_ptr<FlatTree> load(util::MappedFile &&image, const std::vector<Array3> &vertices,
+                                              const std::vector<IndexArray3> &faces);
+
+        /**
+         * Writes the tree as a binary image: a header followed by the nodes and the triangle blocks as they are laid out in memory. The image contains no pointers, only indices and offsets relative to its beginning.
+         * It is keyed by a hash of the polyhedron ({@link meshHash}) and can only be loaded together with the same polyhedron.
+         * @param stream The stream to write to, has to be opened in binary mode.
+         * @throws std::runtime_error if writing fails.
+         */
+        void save(std::ostream &stream) const;
+
+        /**
+         * Calculates the 64 bit FNV-1a hash of a polyhedron, which identifies the polyhedron a saved tree belongs to.
+         * @param vertices The polyhedron's vertices.
+         * @param faces The polyhedron's faces.
+         * @return the hash.
+         */
+        static uint64_t meshHash(const std::vector<Array3> &vertices, const std::vector<IndexArray3> &faces);
+
+        /**
+        * Used to calculate intersections of a ray and the polyhedron's faces.
+        * @param origin The point where the ray originates from.
+        * @param ray Specifies the ray direction.
+        * @param intersections The buffer found intersection points are appended to. Points on edges shared by several faces are appended once per face.
+        */
+        void getFaceIntersections(const Array3 &origin, const Array3 &ray, std::vector<Array3> &intersections) const;
+
+        /**
+        * Used to calculate intersections of a packet of rays and the polyhedron's faces. Rays pointing into the same octant are traversed together using SIMD instructions, otherwise each ray is traversed on its own.
+        * @param origins The points where the rays originate from.
+        * @param rays Specifies the ray directions.
+        * @param intersections The buffers found intersection points are appended to, one buffer per ray.
+        */
+        void getFaceIntersections(const std::array<Array3, PACKET_SIZE> &origins,
+                                  const std::array<Array3, PACKET_SIZE> &rays,
+                                  std::array<std::vector<Array3>, PACKET_SIZE> &intersections) const;
+
+        /**
+         * Counts how often the ray crosses the polyhedron's surface using the watertight intersection test.
+         * @param origin The point where the ray originates from.
+         * @param ray Specifies the ray direction.
+         * @param crossedFaces Buffer used to remember the crossed faces, as faces bound to several leaves are tested once per leaf. Cleared before use.
+         * @return the number of crossings.
+         */
+        [[nodiscard]] size_t countCrossings(const Array3 &origin, const Array3 &ray, std::vector<uint32_t> &crossedFaces) const;
+
+        /**
+         * Finds the intersection of the ray and the polyhedron's faces that is closest to the ray's origin.
+         * @param origin The point where the ray originates from.
+         * @param ray Specifies the ray direction.
+         * @return the closest intersection point or std::nullopt if the ray does not hit the polyhedron.
+         */
+        [[nodiscard]] std::optional<Array3> closestIntersection(const Array3 &origin, const Array3 &ray) const;
+
+        /**
+         * Checks whether the ray hits any of the polyhedron's faces. Stops at the first hit found.
+         * @param origin The point where the ray originates from.
+         * @param ray Specifies the ray direction.
+         * @param tMax Only hits with a parameter t smaller than tMax in $ intersection_point = origin + t * ray $ are considered.
+         * @return true if an intersection exists.
+         */
+        [[nodiscard]] bool anyIntersection(const Array3 &origin, const Array3 &ray, double tMax) const;
+
+        /**
+         * @return the number of nodes in this tree.
+         */
+        [[nodiscard]] size_t size() const;
+
+        /**
+         * Measures the average time the queries spend on one step through a split node and on one ray/triangle test by tracing the given rays twice: once only traversing the tree and once testing the triangles of the visited leaves as well.
+         * Used to calibrate the cost model of the tree building, see {@link BuildOptions::autoTune}.
+         * @param origins The origin points of the rays.
+         * @param rays The ray direction vectors, rays[i] belongs to origins[i].
+         * @return pair of the seconds per traversal step and per triangle test, 0 for an operation that did not occur.
+         */
+        [[nodiscard]] std::pair<double, double> measureCosts(const std::vector<Array3> &origins,
+                                                             const std::vector<Array3> &rays) const;
+
+    private:
+        /**
+         * The version of the binary image written by {@link save}. Incremented whenever the format changes.
+         */
+        static constexpr uint32_t FORMAT_VERSION{1};
+
+        /**
+         * The nodes and triangle blocks of an image start at a multiple of this many bytes.
+         */
+        static constexpr size_t IMAGE_ALIGNMENT{64};
+
+        /**
+         * Creates an empty tree, whose nodes are set by {@link load}.
+         */
+        FlatTree(const std::vector<Array3> &vertices, const std::vector<IndexArray3> &faces, const Box &boundingBox);
+
+        /**
+         * Checks that the nodes reference only existing nodes, triangle blocks and faces and that the depth of the tree is within {@link MAX_RECURSION_DEPTH}, which the traversal stacks rely on.
+         * @throws std::runtime_error if a node or block is invalid.
+         */
+        void validate() const;
+
+        /**
+         * Calls the visitor with every {@link TriangleBlock} of the leaf.
+         * @param leaf The leaf whose triangles to visit.
+         * @param blockVisitor Called with each block and the number of triangles it holds.
+         */
+        template<typename BlockVisitor>
+        void forEachBlock(const FlatNode &leaf, BlockVisitor &&blockVisitor) const {
+            const uint32_t faceCount{leaf.faceCount()};
+            for (uint32_t first = 0; first < faceCount; first += PACKET_SIZE) {
+                blockVisitor(_triangles[leaf.offset + first / PACKET_SIZE],
+                             std::min<size_t>(PACKET_SIZE, faceCount - first));
+            }
+        }
+
+        /**
+         * Calls the visitor with the lane index and the parameter t of each lane set in the hit mask.
+         * @param hit The mask of the lanes to visit.
+         * @param t The parameters t of all lanes.
+         * @param laneVisitor Called with the index and the parameter t of each set lane.
+         */
+        template<typename LaneVisitor>
+        static void forEachHit(const BoolBatch &hit, const DoubleBatch &t, LaneVisitor &&laneVisitor) {
+            const uint64_t hitMask{hit.mask()};
+            if (hitMask == 0) {
+                return;
+            }
+            std::array<double, PACKET_SIZE> tLanes{};
+            t.store_unaligned(tLanes.data());
+            for (size_t lane = 0; lane < PACKET_SIZE; ++lane) {
+                if ((hitMask >> lane & 1u) != 0) {
+                    laneVisitor(lane, tLanes[lane]);
+                }
+            }
+        }
+
+        /**
+         * Tests one ray against all triangles of a block.
+         * @param block The triangles to test against.
+         * @param origin The point where the ray originates from, broadcast to all lanes.
+         * @param ray Specifies the ray direction, broadcast to all lanes.
+         * @return the mask of the triangles hit by the ray and the parameter t for each triangle.
+         */
+        static std::pair<BoolBatch, DoubleBatch> intersect(const TriangleBlock &block, const BatchArray3 &origin,
+                                                           const BatchArray3 &ray);
+
+        /**
+         * Tests a packet of rays against one triangle of a block.
+         * @param block The block holding the triangle.
+         * @param lane The position of the triangle inside the block.
+         * @param origin The points where the rays originate from.
+         * @param ray Specifies the ray directions.
+         * @return the mask of the rays hitting the triangle and the parameter t for each ray.
+         */
+        static std::pair<BoolBatch, DoubleBatch> intersect(const TriangleBlock &block, size_t lane,
+                                                           const BatchArray3 &origin, const BatchArray3 &ray);
+
+        /**
+         * Copies a vector into all lanes of a SIMD register.
+         * @param vector The vector to broadcast.
+         * @return the broadcast vector.
+         */
+        static BatchArray3 broadcast(const Array3 &vector);
+
+        /**
+         * Traverses the leaves whose bounding boxes are hit by the ray in the order the ray passes them (front to back).
+         * @param origin The point where the ray originates from.
+         * @param inverseRay The inverse of the ray direction (1/ray).
+         * @param tLimit Parameter t of the ray beyond which nodes are not visited.
+         * @param leafVisitor Called with each leaf node that is hit by the ray. Returns the new tLimit, which allows to
+         * end the traversal early, e.g. a negative value stops the traversal.
+         */
+        template<typename LeafVisitor>
+        void traverse(const Array3 &origin, const Array3 &inverseRay, const double tLimit, LeafVisitor &&leafVisitor) const {
+            traverse(origin, inverseRay, tLimit, std::forward<LeafVisitor>(leafVisitor), [](const FlatNode &) {
+            });
+        }
+
+        /**
+         * Traverses the leaves like {@link traverse}, additionally calling a visitor with each split node the ray passes through.
+         * @param origin The point where the ray originates from.
+         * @param inverseRay The inverse of the ray direction (1/ray).
+         * @param tLimit Parameter t of the ray beyond which nodes are not visited.
+         * @param leafVisitor Called with each leaf node that is hit by the ray. Returns the new tLimit.
+         * @param splitVisitor Called with each split node that is hit by the ray.
+         */
+        template<typename LeafVisitor, typename SplitVisitor>
+        void traverse(const Array3 &origin, const Array3 &inverseRay, double tLimit, LeafVisitor &&leafVisitor,
+                      SplitVisitor &&splitVisitor) const {
+            //the parameters t of the ray segment passing through a node
+            struct StackEntry {
+                uint32_t index;
+                double tMin;
+                double tMax;
+            };
+            const auto [tEnter, tExit] = _boundingBox.rayBoxIntersection(origin, inverseRay);
+            // bounding box was not hit because the ray passed the box or is moving into the opposite direction of it
+            if (tExit < tEnter || tExit < 0) {
+                return;
+            }
+            //each level pushes at most one far child, so the depth limit bounds the stack size
+            std::array<StackEntry, MAX_RECURSION_DEPTH + 1> stack{};
+            size_t stackSize{0};
+            stack[stackSize++] = {0, std::max(tEnter, 0.0), tExit};
+            while (stackSize > 0) {
+                auto [index, tMin, tMax] = stack[--stackSize];
+                //the remaining segment of the ray lies behind the limit
+                if (tMin > tLimit) {
+                    continue;
+                }
+                while (!_nodes[index].isLeaf()) {
+                    const FlatNode &node{_nodes[index]};
+                    splitVisitor(node);
+                    const size_t axis{node.axis()};
+                    const uint32_t lesser{index + 1};
+                    const uint32_t greater{node.offset};
+                    // the ray is parallel to the split plane -> only the side containing the origin is hit, both if the origin lies in the plane
+                    if (std::isinf(inverseRay[axis])) {
+                        if (origin[axis] == node.axisCoordinate) {
+                            stack[stackSize++] = {greater, tMin, tMax};
+                        }
+                        index = origin[axis] <= node.axisCoordinate ? lesser : greater;
+                        continue;
+                    }
+                    const double tSplit{Plane{node.axisCoordinate, static_cast<Direction>(axis)}.rayPlaneIntersection(origin, inverseRay)};
+                    // rays in positive direction pass the lesser box first
+                    const bool lesserIsNear{inverseRay[axis] > 0};
+                    const uint32_t near{lesserIsNear ? lesser : greater};
+                    const uint32_t far{lesserIsNear ? greater : lesser};
+                    if (tSplit > tMax) {
+                        index = near;
+                    } else if (tSplit < tMin) {
+                        index = far;
+                    } else {
+                        //the split plane is hit inside the node -> visit both children, the far one later
+                        stack[stackSize++] = {far, tSplit, tMax};
+                        index = near;
+                        tMax = tSplit;
+                    }
+                }
+                tLimit = leafVisitor(_nodes[index]);
+            }
+        }
+
+        /**
+         * Traverses the leaves whose bounding boxes are hit by at least one ray of a packet. All rays have to point into the same octant, so that they agree on the near child of every split node.
+         * @param origin The points where the rays originate from.
+         * @param inverseRay The inverse of the ray directions (1/ray).
+         * @param leafVisitor Called with each leaf node that is hit and the mask of the rays hitting it.
+         */
+        template<typename LeafVisitor>
+        void traversePacket(const BatchArray3 &origin, const BatchArray3 &inverseRay, LeafVisitor &&leafVisitor) const {
+            //the parameters t of the ray segments passing through a node and the rays still passing through it
+            struct StackEntry {
+                uint32_t index;
+                DoubleBatch tMin;
+                DoubleBatch tMax;
+                BoolBatch active;
+            };
+            const auto [tEnter, tExit] = _boundingBox.rayBoxIntersection(origin, inverseRay);
+            const BoolBatch hit{(tExit >= tEnter) & (tExit >= DoubleBatch(0.0))};
+            if (!xsimd::any(hit)) {
+                return;
+            }
+            const std::array<bool, DIMENSIONS> lesserIsNear{
+                xsimd::any(inverseRay[0] > DoubleBatch(0.0)), xsimd::any(inverseRay[1] > DoubleBatch(0.0)),
+                xsimd::any(inverseRay[2] > DoubleBatch(0.0))
+            };
+            std::array<StackEntry, MAX_RECURSION_DEPTH + 1> stack{};
+            size_t stackSize{0};
+            stack[stackSize++] = {0, xsimd::max(tEnter, DoubleBatch(0.0)), tExit, hit};
+            while (stackSize > 0) {
+                auto [index, tMin, tMax, active] = stack[--stackSize];
+                while (!_nodes[index].isLeaf()) {
+                    const FlatNode &node{_nodes[index]};
+                    const size_t axis{node.axis()};
+                    const uint32_t near{lesserIsNear[axis] ? index + 1 : node.offset};
+                    const uint32_t far{lesserIsNear[axis] ? node.offset : index + 1};
+                    const DoubleBatch tSplit{Plane{node.axisCoordinate, static_cast<Direction>(axis)}.rayPlaneIntersection(origin, inverseRay)};
+                    // rays parallel to the split plane whose origin lies in the plane pass both children
+                    const BoolBatch inPlane{xsimd::isinf(inverseRay[axis]) & (origin[axis] == DoubleBatch(node.axisCoordinate))};
+                    const BoolBatch visitNear{active & ((tSplit >= tMin) | inPlane)};
+                    const BoolBatch visitFar{active & ((tSplit <= tMax) | inPlane)};
+                    const DoubleBatch farTMin{xsimd::select(inPlane, tMin, xsimd::max(tMin, tSplit))};
+                    if (!xsimd::any(visitNear)) {
+                        index = far;
+                        tMin = farTMin;
+                        active = visitFar;
+                        continue;
+                    }
+                    if (xsimd::any(visitFar)) {
+                        stack[stackSize++] = {far, farTMin, tMax, visitFar};
+                    }
+                    index = near;
+                    tMax = xsimd::select(inPlane, tMax, xsimd::min(tMax, tSplit));
+                    active = visitNear;
+                }
+                leafVisitor(_nodes[index], active);
+            }
+        }
+    };
+
+}// namespace kdtree
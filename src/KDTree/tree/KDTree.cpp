@@ -1,88 +1,325 @@
 #include "KDTree/tree/KDTree.h"
 
+#include <fstream>
+
 #include "KDTree/input/TetgenAdapter.h"
 
 namespace kdtree {
     //on initialization of the tree a single bounding box which includes all the faces of the polyhedron is generated. Both the list of included faces and the parameters of the box are written to the split parameters
-    KDTree::KDTree(const std::vector<Array3> &vertices, const std::vector<IndexArray3> &faces,
-                   const PlaneSelectionAlgorithm::Algorithm algorithm)
-        : _vertices{vertices}, _faces{faces},
+    KDTree::KDTree(std::vector<Array3> vertices, std::vector<IndexArray3> faces,
+                   const PlaneSelectionAlgorithm::Algorithm algorithm, const BuildOptions &options)
+        : _vertices{std::move(vertices)}, _faces{std::move(faces)}, _options{options}, _arena{createNodeArena()},
           _splitParam{
-              std::make_unique<SplitParam>(_vertices, _faces, Box::getBoundingBox(_vertices), Direction::X,
-                                           PlaneSelectionAlgorithmFactory::create(algorithm))
+              std::in_place, _vertices, _faces, Box::getBoundingBox(_vertices), Direction::X,
+              PlaneSelectionAlgorithmFactory::create(algorithm), _arena, _options
           } {
+        _options.validate();
     }
 
-    KDTree::KDTree(const std::tuple<std::vector<Array3>, std::vector<IndexArray3>> &polySource,
-                   const PlaneSelectionAlgorithm::Algorithm algorithm)
-    : KDTree(std::get<0>(polySource), std::get<1>(polySource), algorithm)
+    KDTree::KDTree(std::tuple<std::vector<Array3>, std::vector<IndexArray3>> polySource,
+                   const PlaneSelectionAlgorithm::Algorithm algorithm, const BuildOptions &options)
+    : KDTree(std::move(std::get<0>(polySource)), std::move(std::get<1>(polySource)), algorithm, options)
 {}
 
 
-    KDTree::KDTree(const std::string &nodeFilePath, const std::string &faceFilePath, const PlaneSelectionAlgorithm::Algorithm algorithm) : KDTree(TetgenAdapter{{nodeFilePath, faceFilePath}}.getPolyhedralSource(),algorithm) {}
+    KDTree::KDTree(const std::string &nodeFilePath, const std::string &faceFilePath, const PlaneSelectionAlgorithm::Algorithm algorithm,
+                   const BuildOptions &options) : KDTree(TetgenAdapter{{nodeFilePath, faceFilePath}}.getPolyhedralSource(),algorithm, options) {}
+
+    KDTree::KDTree(std::vector<Array3> vertices, std::vector<IndexArray3> faces, util::MappedFile &&image)
+        : KDTree(std::move(vertices), std::move(faces)) {
+        _flatTree = FlatTree::load(std::move(image), _vertices, _faces);
+        //the loaded tree is never built lazily -> release the face list and the planner of the root node right away
+        _splitParam.reset();
+        _isFrozen.store(true, std::memory_order_release);
+    }
 
-    std::shared_ptr<TreeNode> KDTree::getRootNode() {
+    TreeNode *KDTree::getRootNode() {
         //if the node has already been generated, don't do it again. Let the factory determine the TreeNode subclass based on the optimal split.
-        std::call_once(_rootNodeCreated, [this] {
-            this->_rootNode = TreeNodeFactory::createTreeNode(*std::move(_splitParam), 0);
-        });
-        return this->_rootNode;
+        TreeNode *root{_root.load(std::memory_order_acquire)};
+        if (root == nullptr) {
+            //a tree is only frozen without its nodes if it has been loaded, its parameters have been released
+            if (_isFrozen.load(std::memory_order_acquire)) {
+                throw std::runtime_error("A loaded tree has no nodes, it only consists of its flat representation.");
+            }
+            _rootBuild.callOnce([this] {
+                this->_rootNode = TreeNodeFactory::createTreeNode(*std::move(_splitParam), 0);
+                //the parameters have been moved into the root node
+                _splitParam.reset();
+                _root.store(this->_rootNode.get(), std::memory_order_release);
+            });
+            root = _root.load(std::memory_order_acquire);
+        }
+        return root;
     }
 
     size_t KDTree::countIntersections(const Array3 &origin, const Array3 &ray) {
-        //it's possible that a single intersection point is on the edge between two triangles. The point would be counted twice if the intersection points were not documented -> use of std::set
-        std::set<Array3> set{};
-        this->getFaceIntersections(origin, ray, set);
-        return set.size();
+        return countIntersections(origin, ray, QueryContext::threadLocal());
+    }
+
+    size_t KDTree::countIntersections(const Array3 &origin, const Array3 &ray, QueryContext &context) {
+        collectFaceIntersections(origin, ray, context);
+        //it's possible that a single intersection point is on the edge between two triangles. The point would be counted twice if duplicates were not removed
+        return QueryContext::removeDuplicates(context.intersections);
+    }
+
+    std::vector<size_t> KDTree::countIntersections(const std::vector<Array3> &origins,
+                                                   const std::vector<Array3> &rays) {
+        if (origins.size() != rays.size()) {
+            throw std::invalid_argument("The number of ray origins and ray directions must be equal.");
+        }
+        const FlatTree &flatTree{getFlatTree()};
+        std::vector<size_t> counts(origins.size());
+        if (origins.empty()) {
+            return counts;
+        }
+        //the rays are independent of each other -> parallelize across packets of consecutive rays, which are traversed together using SIMD instructions
+        const size_t packetCount{(origins.size() + PACKET_SIZE - 1) / PACKET_SIZE};
+        thrust::for_each(thrust::device, thrust::counting_iterator<size_t>(0),
+                         thrust::counting_iterator<size_t>(packetCount),
+                         [&flatTree, &origins, &rays, &counts](const size_t packetIndex) {
+                             //each thread reuses its own buffers across packets
+                             auto &intersections{QueryContext::threadLocal().packetIntersections};
+                             const size_t first{packetIndex * PACKET_SIZE};
+                             const size_t last{std::min(first + PACKET_SIZE, origins.size())};
+                             //the last packet is padded with copies of its last ray, whose results are discarded
+                             std::array<Array3, PACKET_SIZE> packetOrigins{};
+                             std::array<Array3, PACKET_SIZE> packetRays{};
+                             for (size_t lane = 0; lane < PACKET_SIZE; ++lane) {
+                                 packetOrigins[lane] = origins[std::min(first + lane, last - 1)];
+                                 packetRays[lane] = rays[std::min(first + lane, last - 1)];
+                             }
+                             for (auto &laneIntersections: intersections) {
+                                 laneIntersections.clear();
+                             }
+                             flatTree.getFaceIntersections(packetOrigins, packetRays, intersections);
+                             for (size_t index = first; index < last; ++index) {
+                                 counts[index] = QueryContext::removeDuplicates(intersections[index - first]);
+                             }
+                         });
+        return counts;
+    }
+
+    size_t KDTree::countCrossings(const Array3 &origin, const Array3 &ray) {
+        return countCrossings(origin, ray, QueryContext::threadLocal());
+    }
+
+    size_t KDTree::countCrossings(const Array3 &origin, const Array3 &ray, QueryContext &context) {
+        return getFlatTree().countCrossings(origin, ray, context.crossedFaces);
+    }
+
+    bool KDTree::isInside(const Array3 &point) {
+        return isInside(point, QueryContext::threadLocal());
+    }
+
+    bool KDTree::isInside(const Array3 &point, QueryContext &context) {
+        return countCrossings(point, INSIDE_TEST_RAY, context) % 2 == 1;
     }
 
     void KDTree::getFaceIntersections(const Array3 &origin, const Array3 &ray, std::set<Array3> &intersections) {
-        //iterative approach to avoid stack and heap overflows
-        //queue for children of processed nodes
-        std::deque<std::shared_ptr<TreeNode> > queue{};
-        //calculate inverse ray direction
-        const Array3 inverseRay{1. / ray[0], 1. / ray[1], 1. / ray[2]};
-        //init with tree root
-        queue.push_back(getRootNode());
-        while (!queue.empty()) {
-            auto node = queue.front();
-            //if node is SplitNode perform intersection checks on the children and queue them accordingly
-            if (const auto split = std::dynamic_pointer_cast<SplitNode>(node)) {
-                const auto children = split->getChildrenForIntersection(origin, ray, inverseRay);
-                std::for_each(std::begin(children), std::end(children), [&queue](const auto &child) {
-                    queue.push_back(child);
-                });
+        const std::vector<Array3> &found{collectFaceIntersections(origin, ray, QueryContext::threadLocal())};
+        intersections.insert(found.cbegin(), found.cend());
+    }
+
+    const std::vector<Array3> &KDTree::collectFaceIntersections(const Array3 &origin, const Array3 &ray,
+                                                               QueryContext &context) {
+        context.intersections.clear();
+        //the frozen tree answers the query without touching the lazily built nodes
+        if (_isFrozen.load(std::memory_order_acquire)) {
+            _flatTree->getFaceIntersections(origin, ray, context.intersections);
+            return context.intersections;
+        }
+        {
+            //no subtree is evicted during the traversal, without a budget nothing is ever evicted -> no need to lock
+            std::shared_lock lock{_evictionMutex, std::defer_lock};
+            if (_memoryBudget.load(std::memory_order_relaxed) != 0) {
+                lock.lock();
             }
-            //if node is leaf then perform intersections with the triangles contained
-            else if (const auto leaf = std::dynamic_pointer_cast<LeafNode>(node)) {
-                leaf->getFaceIntersections(origin, ray, intersections);
+            //iterative approach to avoid stack overflows, the nodes are owned by the tree -> no reference counting needed
+            std::vector<TreeNode *> &stack{context.nodeStack};
+            stack.clear();
+            //calculate inverse ray direction
+            const Array3 inverseRay{1. / ray[0], 1. / ray[1], 1. / ray[2]};
+            //the nodes at which the query reaches the unbuilt part of the tree are built by the background pool first
+            BackgroundBuild *backgroundBuild{_backgroundBuild.load(std::memory_order_acquire)};
+            //init with tree root
+            stack.push_back(getRootNode());
+            while (!stack.empty()) {
+                TreeNode *node{stack.back()};
+                stack.pop_back();
+                //if node is SplitNode perform intersection checks on the children and push them accordingly
+                if (auto *split = dynamic_cast<SplitNode *>(node)) {
+                    if (backgroundBuild != nullptr && !(split->isChildBuilt(0) && split->isChildBuilt(1))) {
+                        backgroundBuild->prioritize(split);
+                    }
+                    for (TreeNode *child: split->getChildrenForIntersection(origin, ray, inverseRay)) {
+                        if (child != nullptr) {
+                            stack.push_back(child);
+                        }
+                    }
+                }
+                //if node is leaf then perform intersections with the triangles contained
+                else if (auto *leaf = dynamic_cast<LeafNode *>(node)) {
+                    leaf->getFaceIntersections(origin, ray, context.intersections);
+                }
             }
-            queue.pop_front();
         }
+        evictIfOverBudget();
+        return context.intersections;
+    }
+
+    std::optional<Array3> KDTree::closestIntersection(const Array3 &origin, const Array3 &ray) {
+        return getFlatTree().closestIntersection(origin, ray);
+    }
+
+    bool KDTree::anyIntersection(const Array3 &origin, const Array3 &ray, const double tMax) {
+        return getFlatTree().anyIntersection(origin, ray, tMax);
+    }
+
+    const FlatTree &KDTree::getFlatTree() {
+        if (!_isFrozen.load(std::memory_order_acquire)) {
+            prebuildTree();
+        }
+        return *_flatTree;
     }
 
     KDTree &KDTree::prebuildTree() {
-        //queue for children of processed nodes
-        std::deque<std::shared_ptr<TreeNode> > queue{};
-        //subsequently call getter functions for the root node and all child nodes to initiate a full build of the tree
-        queue.push_back(getRootNode());
-        while (!queue.empty()) {
-            auto node = queue.front();
-            //if node is SplitNode perform intersection checks on the children and queue them accordingly
-            if (const auto split = std::dynamic_pointer_cast<SplitNode>(node)) {
-                //build child nodes and add them to the queue
-                queue.push_back(split->getChildNode(0));
-                queue.push_back(split->getChildNode(1));
-            }
-            //remove the processed node as its direct children have been built by getChildNode
-            queue.pop_front();
+        if (_isFrozen.load(std::memory_order_acquire)) {
+            return *this;
         }
+        //no subtree is evicted while the tree is built and converted
+        std::shared_lock lock{_evictionMutex};
+        //sibling subtrees are independent of each other -> build them as parallel tasks
+        util::parallelRegion([this] {
+            buildSubtree(getRootNode(), 0);
+        });
+        //convert the built tree into its flat representation for faster queries
+        std::call_once(_flatTreeCreated, [this] {
+            _flatTree = std::make_unique<FlatTree>(getRootNode(), Box::getBoundingBox(_vertices), _vertices, _faces);
+            _isFrozen.store(true, std::memory_order_release);
+        });
         return *this;
     }
 
+    void KDTree::setMemoryBudget(const size_t bytes) {
+        //the background build keeps pointers to the nodes on its frontier, which an eviction would invalidate. Checked and set under the lock, so that a concurrently started build sees the budget
+        std::lock_guard lock{_buildModeMutex};
+        if (bytes != 0 && _backgroundBuild.load(std::memory_order_acquire) != nullptr) {
+            throw std::runtime_error("A memory budget cannot be combined with a background build.");
+        }
+        _memoryBudget.store(bytes, std::memory_order_relaxed);
+    }
+
+    KDTree &KDTree::buildInBackground(const size_t threadCount, BackgroundBuild::ProgressCallback progress) {
+        std::lock_guard lock{_buildModeMutex};
+        //a frozen tree is complete, there is nothing left to build
+        if (_isFrozen.load(std::memory_order_acquire)) {
+            return *this;
+        }
+        if (_memoryBudget.load(std::memory_order_relaxed) != 0) {
+            throw std::runtime_error("A memory budget cannot be combined with a background build.");
+        }
+        //only the first call starts a build
+        if (_backgroundBuildOwner == nullptr) {
+            _backgroundBuildOwner = std::make_unique<BackgroundBuild>(*this, threadCount, std::move(progress));
+            _backgroundBuild.store(_backgroundBuildOwner.get(), std::memory_order_release);
+        }
+        return *this;
+    }
+
+    void KDTree::cancelBackgroundBuild() {
+        if (BackgroundBuild *backgroundBuild = _backgroundBuild.load(std::memory_order_acquire)) {
+            backgroundBuild->cancel();
+        }
+    }
+
+    void KDTree::waitForBackgroundBuild() {
+        if (BackgroundBuild *backgroundBuild = _backgroundBuild.load(std::memory_order_acquire)) {
+            backgroundBuild->wait();
+        }
+    }
+
+    size_t KDTree::memoryUsage() const {
+        return _arena->bytesInUse();
+    }
+
+    void KDTree::evictIfOverBudget() {
+        const size_t budget{_memoryBudget.load(std::memory_order_relaxed)};
+        if (budget == 0 || _arena->bytesInUse() <= budget || _isFrozen.load(std::memory_order_acquire)) {
+            return;
+        }
+        //queries don't wait for the eviction to be possible, a later query evicts instead
+        std::unique_lock lock{_evictionMutex, std::try_to_lock};
+        if (!lock.owns_lock()) {
+            return;
+        }
+        auto *root = dynamic_cast<SplitNode *>(getRootNode());
+        if (root == nullptr) {
+            return;
+        }
+        //the first sweep clears the reference bits of the recently used nodes, so that the second sweep may evict them if the budget is still exceeded
+        for (size_t sweep = 0; sweep < 2 && _arena->bytesInUse() > budget; ++sweep) {
+            root->evictColdChildren(*_arena, budget);
+        }
+    }
+
+    void KDTree::save(const std::string &path) {
+        std::ofstream file{path, std::ios::binary | std::ios::trunc};
+        if (!file) {
+            throw std::runtime_error("The file " + path + " cannot be opened for writing.");
+        }
+        save(file);
+        file.close();
+        if (!file) {
+            throw std::runtime_error("The file " + path + " could not be written.");
+        }
+    }
+
+    void KDTree::save(std::ostream &stream) {
+        getFlatTree().save(stream);
+    }
+
+    KDTree KDTree::load(const std::string &path, const std::vector<Array3> &vertices, const std::vector<IndexArray3> &faces) {
+        return KDTree{vertices, faces, util::MappedFile{path}};
+    }
+
+    KDTree KDTree::load(std::istream &stream, const std::vector<Array3> &vertices, const std::vector<IndexArray3> &faces) {
+        return KDTree{vertices, faces, util::MappedFile::fromStream(stream)};
+    }
+
+    const std::vector<Array3> &KDTree::getVertices() const {
+        return _vertices;
+    }
+
+    const std::vector<IndexArray3> &KDTree::getFaces() const {
+        return _faces;
+    }
+
+    void KDTree::buildSubtree(TreeNode *node, const size_t depth) {
+        const auto split = dynamic_cast<SplitNode *>(node);
+        if (split == nullptr) {
+            return;
+        }
+        const auto buildLesser = [split, depth] {
+            buildSubtree(split->getChildNode(0), depth + 1);
+        };
+        const auto buildGreater = [split, depth] {
+            buildSubtree(split->getChildNode(1), depth + 1);
+        };
+        //deeper subtrees are built sequentially inside their task to keep the scheduling overhead low
+        if (depth < PARALLEL_BUILD_DEPTH) {
+            util::parallelInvoke(buildLesser, buildGreater);
+        } else {
+            buildLesser();
+            buildGreater();
+        }
+    }
+
     std::ostream &operator<<(std::ostream &os, const KDTree &kdTree) {
         if (kdTree._rootNode != nullptr) {
             os << *(kdTree._rootNode);
+        } else if (kdTree._isFrozen.load(std::memory_order_acquire)) {
+            //a loaded tree has no nodes to print
+            os << "KDTree loaded with " << kdTree._flatTree->size() << " nodes";
         } else {
             os << "KDTree rootNode is empty!";
         }
@@ -2,27 +2,41 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstddef>
 #include <deque>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <mutex>
+#include <istream>
+#include <optional>
 #include <ostream>
 #include <set>
+#include <shared_mutex>
+#include <stdexcept>
 #include <thrust/execution_policy.h>
 #include <thrust/for_each.h>
+#include <thrust/iterator/counting_iterator.h>
 #include <utility>
 #include <vector>
 
+#include "KDTree/tree/BackgroundBuild.h"
+#include "KDTree/tree/BuildOptions.h"
+#include "KDTree/tree/FlatTree.h"
 #include "KDTree/tree/KdDefinitions.h"
 #include "KDTree/tree/LeafNode.h"
+#include "KDTree/tree/NodeArena.h"
+#include "KDTree/tree/QueryContext.h"
 #include "KDTree/tree/SplitNode.h"
 #include "KDTree/tree/SplitParam.h"
 #include "KDTree/tree/TreeNode.h"
 #include "KDTree/tree/TreeNodeFactory.h"
 #include "KDTree/plane_selection/PlaneSelectionAlgorithm.h"
 #include "KDTree/plane_selection/PlaneSelectionAlgorithmFactory.h"
+#include "KDTree/util/MappedFile.h"
 #include "KDTree/util/UtilityContainer.h"
+#include "KDTree/util/UtilityParallel.h"
 
 namespace kdtree {
     /**
@@ -32,13 +46,18 @@ namespace kdtree {
         /**
          * friend declaration for testing purposes.
          */
-        friend class KDTreeTest_AlgorithmRegressionTest_Test;
+        friend class KDTreeRegressionTest_AlgorithmRegressionTest_Test;
 
         /**
-        * The entry node of the KDTree. Only access using getter.
+        * Owns the entry node of the KDTree. Only access using getter.
         */
         std::shared_ptr<TreeNode> _rootNode;
 
+        /**
+         * The entry node once it has been created, nullptr before. Published with release semantics, so that queries find the built root with a single acquire load.
+         */
+        std::atomic<TreeNode *> _root{nullptr};
+
         /**
          * The polyhedron's vertices.
          */
@@ -49,14 +68,64 @@ namespace kdtree {
         const std::vector<IndexArray3> _faces;
 
         /**
-         * Set when the root node has been created.
+         * The cost constants and termination criteria used to build the nodes. {@link BuildOptions}
+         */
+        const BuildOptions _options;
+
+        /**
+         * Serializes the creation of the root node, the first queries help building it. {@link util::CooperativeOnce}
+         */
+        util::CooperativeOnce _rootBuild;
+
+        /**
+         * The memory the nodes of the tree are allocated from. {@link NodeArena}
          */
-        std::once_flag _rootNodeCreated;
+        NodeArena _arena;
 
         /**
-        * Parameters for lazily building the root node {@link SplitParam}
+        * Parameters for lazily building the root node {@link SplitParam}. Freed once the root node is built.
         */
-        std::unique_ptr<SplitParam> _splitParam;
+        std::optional<SplitParam> _splitParam;
+
+        /**
+         * The memory the lazily built nodes may use in bytes, 0 for unlimited. See {@link setMemoryBudget}.
+         */
+        std::atomic_size_t _memoryBudget{0};
+
+        /**
+         * Held exclusively by the eviction of cold subtrees and shared by the builds and, while a memory budget is set, by the traversals of the lazily built nodes.
+         */
+        std::shared_mutex _evictionMutex;
+
+        /**
+         * Set when the tree has been frozen into its flat representation.
+         */
+        std::once_flag _flatTreeCreated;
+
+        /**
+         * The flat representation of the fully built tree {@link FlatTree}. Only access after checking _isFrozen.
+         */
+        std::unique_ptr<FlatTree> _flatTree;
+
+        /**
+         * True once the _flatTree is available and queries are answered by it.
+         */
+        std::atomic_bool _isFrozen{false};
+
+        /**
+         * Serializes {@link setMemoryBudget} and {@link buildInBackground}, so that a budget and a background build are never both accepted. Also guards the start of the background build.
+         */
+        std::mutex _buildModeMutex;
+
+        /**
+         * The running or finished background build, nullptr if none has been started. Published with release semantics, queries report the nodes they reach to it.
+         */
+        std::atomic<BackgroundBuild *> _backgroundBuild{nullptr};
+
+        /**
+         * Owns the background build {@link BackgroundBuild}. Declared last, so that its threads are stopped before the remaining members are destroyed.
+         */
+        std::unique_ptr<BackgroundBuild> _backgroundBuildOwner;
 
     public:
         /**
@@ -64,35 +133,44 @@ namespace kdtree {
         * @param vertices The vertex coordinates of the polyhedron
         * @param faces The faces of the polyhedron with a face being a triplet of vertex indices
         * @param algorithm Specifies which algorithm to use for finding optimal split planes.
+        * @param options The cost constants and termination criteria of the tree building, see {@link BuildOptions::autoTune} to derive them from the hardware.
         * @return the lazily built KDTree.
+        * @throws std::invalid_argument if the options are invalid.
         */
-        KDTree(const std::vector<Array3> &vertices, const std::vector<IndexArray3> &faces,
-               PlaneSelectionAlgorithm::Algorithm algorithm = PlaneSelectionAlgorithm::Algorithm::LOG);
+        KDTree(std::vector<Array3> vertices, std::vector<IndexArray3> faces,
+               PlaneSelectionAlgorithm::Algorithm algorithm = PlaneSelectionAlgorithm::Algorithm::LOG,
+               const BuildOptions &options = {});
 
         /**
          * Call to build a KDTree to speed up intersections of rays with a polyhedron's faces.
          * @param nodeFilePath The path to the .node file containing information about the polyhedron's vertices.
          * @param faceFilePath The path to the .face file containing information about the polyhedron's faces.
          * @param algorithm Specifies which algorithm to use for finding optimal split planes.
+         * @param options The cost constants and termination criteria of the tree building.
          * @return the lazily built KDTree.
+         * @throws std::invalid_argument if the options are invalid.
          */
-        KDTree(const std::string &nodeFilePath, const std::string &faceFilePath, PlaneSelectionAlgorithm::Algorithm algorithm = PlaneSelectionAlgorithm::Algorithm::LOG);
+        KDTree(const std::string &nodeFilePath, const std::string &faceFilePath, PlaneSelectionAlgorithm::Algorithm algorithm = PlaneSelectionAlgorithm::Algorithm::LOG,
+               const BuildOptions &options = {});
 
         /**
-         * Constructor overload that allows passing the paths for the .node and .face files in a std::pair.
-         * @param polySource The pair of the .node and .face file
+         * Constructor overload that allows passing the polyhedron as read by the {@link TetgenAdapter}, whose vectors are moved into the tree.
+         * @param polySource The vertices and faces of the polyhedron
          * @param algorithm Specifies which algorithm to use for finding optimal split planes.
+         * @param options The cost constants and termination criteria of the tree building.
          * @return the lazily built KDTree.
+         * @throws std::invalid_argument if the options are invalid.
          */
-        KDTree(const std::tuple<std::vector<Array3>, std::vector<IndexArray3>> &polySource,
-               PlaneSelectionAlgorithm::Algorithm algorithm);
+        KDTree(std::tuple<std::vector<Array3>, std::vector<IndexArray3>> polySource,
+               PlaneSelectionAlgorithm::Algorithm algorithm, const BuildOptions &options = {});
 
 
         /**
         * Creates the root tree node if not initialized and returns it.
-        * @return the root tree Node.
+        * @return the root tree Node, owned by the tree.
+        * @throws std::runtime_error if the tree has been restored by {@link load}, which only restores the {@link FlatTree}.
         */
-        std::shared_ptr<TreeNode> getRootNode();
+        TreeNode *getRootNode();
 
         /**
         * Used to calculate intersections of a ray and the polyhedron's faces contained in this node.
@@ -111,10 +189,215 @@ namespace kdtree {
         size_t countIntersections(const Array3 &origin, const Array3 &ray);
 
         /**
-         * Prebuilds the whole KDTree bypassing lazy loading entirely.
+         * Calculates the number of intersections of a ray with the polyhedron, using the buffers of the given context. Does not allocate memory once the buffers have grown large enough.
+         * @param origin The origin point of the ray.
+         * @param ray The ray direction vector.
+         * @param context The scratch memory of the query, reused across queries.
+         * @return the number of intersections.
+         */
+        size_t countIntersections(const Array3 &origin, const Array3 &ray, QueryContext &context);
+
+        /**
+         * Calculates the number of intersections for a batch of rays with the polyhedron. The rays are distributed over the threads of the parallelization backend.
+         * The query requires the whole tree, which is built on the first call if {@link prebuildTree} has not been called before.
+         * @param origins The origin points of the rays.
+         * @param rays The ray direction vectors, rays[i] belongs to origins[i].
+         * @return the number of intersections for each ray.
+         * @throws std::invalid_argument if the number of origins and rays differ.
+         */
+        std::vector<size_t> countIntersections(const std::vector<Array3> &origins, const std::vector<Array3> &rays);
+
+        /**
+         * Calculates how often a ray crosses the polyhedron's surface. Uses a watertight intersection test, which counts a ray passing through an edge or vertex shared by several faces exactly once,
+         * so no intersection points have to be collected and compared.
+         * The query requires the whole tree, which is built on the first call if {@link prebuildTree} has not been called before.
+         * @param origin The origin point of the ray.
+         * @param ray The ray direction vector.
+         * @return the number of crossings.
+         */
+        size_t countCrossings(const Array3 &origin, const Array3 &ray);
+
+        /**
+         * Calculates how often a ray crosses the polyhedron's surface, using the buffers of the given context. See {@link countCrossings}.
+         * @param origin The origin point of the ray.
+         * @param ray The ray direction vector.
+         * @param context The scratch memory of the query, reused across queries.
+         * @return the number of crossings.
+         */
+        size_t countCrossings(const Array3 &origin, const Array3 &ray, QueryContext &context);
+
+        /**
+         * Checks whether a point lies inside the polyhedron by the parity of the crossings of a ray starting in the point. Points on the surface may be classified either way.
+         * The query requires the whole tree, which is built on the first call if {@link prebuildTree} has not been called before.
+         * @param point The point to check.
+         * @return true if the point lies inside the polyhedron.
+         */
+        bool isInside(const Array3 &point);
+
+        /**
+         * Checks whether a point lies inside the polyhedron, using the buffers of the given context. See {@link isInside}.
+         * @param point The point to check.
+         * @param context The scratch memory of the query, reused across queries.
+         * @return true if the point lies inside the polyhedron.
+         */
+        bool isInside(const Array3 &point, QueryContext &context);
+
+        /**
+         * Finds the intersection of a ray with the polyhedron that is closest to the ray's origin. Nodes are traversed front to back, so the search stops as soon as no closer hit is possible.
+         * The query requires the whole tree, which is built on the first call if {@link prebuildTree} has not been called before.
+         * @param origin The origin point of the ray.
+         * @param ray The ray direction vector.
+         * @return the closest intersection point or std::nullopt if the ray misses the polyhedron.
+         */
+        std::optional<Array3> closestIntersection(const Array3 &origin, const Array3 &ray);
+
+        /**
+         * Checks whether a ray intersects the polyhedron, e.g. for line of sight tests. The traversal stops at the first hit found.
+         * The query requires the whole tree, which is built on the first call if {@link prebuildTree} has not been called before.
+         * @param origin The origin point of the ray.
+         * @param ray The ray direction vector.
+         * @param tMax Only hits with a parameter t smaller than tMax in $ intersection_point = origin + t * ray $ are considered.
+         * @return true if the ray hits the polyhedron.
+         */
+        bool anyIntersection(const Array3 &origin, const Array3 &ray,
+                             double tMax = std::numeric_limits<double>::infinity());
+
+        /**
+         * Prebuilds the whole KDTree bypassing lazy loading entirely. Independent subtrees are built in parallel by the tasks of the parallelization backend. Afterward the tree is frozen into a {@link FlatTree}, which answers all further queries.
          */
         KDTree &prebuildTree();
 
+        /**
+         * Limits the memory used by the lazily built nodes. Whenever a query leaves the tree above the budget, subtrees that have not been traversed recently are collapsed back into their unbuilt state
+         * and rebuilt once a ray reaches them again (clock policy). Queries never wait for an eviction: if other queries are traversing the tree, a later query evicts instead.
+         * The root node and its direct face lists are never evicted, so the usage may stay above very small budgets. Queries answered by the frozen tree ({@link prebuildTree}) are not affected.
+         * Without a budget the queries traverse the lazily built nodes without any locking, so that they don't contend on a shared lock. Hence it must not be called while other threads query the tree.
+         * Pointers to nodes below the root obtained through {@link getRootNode} become invalid once their subtree is evicted.
+         * @param bytes The budget in bytes, 0 disables the eviction.
+         * @throws std::runtime_error if a budget is set after a background build has been started ({@link buildInBackground}).
+         */
+        void setMemoryBudget(size_t bytes);
+
+        /**
+         * Builds the tree on a pool of background threads and returns right away, while queries are answered lazily in the meantime. The pool builds the subtrees reached by queries first
+         * and freezes the tree once it is complete, so that the queries switch to the {@link FlatTree}. Only the first call starts a build, later calls and calls on a frozen tree return right away.
+         * @param threadCount The number of threads of the pool, 0 for the number of hardware threads.
+         * @param progress Called while the build proceeds. {@link BackgroundBuild::ProgressCallback}
+         * @return this tree.
+         * @throws std::runtime_error if a memory budget is set.
+         */
+        KDTree &buildInBackground(size_t threadCount = 0, BackgroundBuild::ProgressCallback progress = {});
+
+        /**
+         * Stops the background build after the nodes currently under construction, the remaining nodes are built lazily by the queries. Does nothing if no build has been started.
+         */
+        void cancelBackgroundBuild();
+
+        /**
+         * Blocks until the background build has frozen the tree or has been cancelled. Returns right away if no build has been started.
+         * @throws the exception that aborted the background build, if any.
+         */
+        void waitForBackgroundBuild();
+
+        /**
+         * @return the amount of bytes currently used by the lazily built nodes and their face lists.
+         */
+        [[nodiscard]] size_t memoryUsage() const;
+
+        /**
+         * Writes the tree to a binary file, from which {@link load} restores it without building it again. The tree is built and frozen first if necessary.
+         * The file is versioned, contains no pointers and is keyed by a hash of the polyhedron, see {@link FlatTree::save}. It is only readable on platforms with the same memory layout and SIMD width.
+         * @param path The path of the file to write.
+         * @throws std::runtime_error if the file cannot be written.
+         */
+        void save(const std::string &path);
+
+        /**
+         * Writes the tree in the binary format of {@link save(const std::string &)} to a stream.
+         * @param stream The stream to write to, has to be opened in binary mode.
+         * @throws std::runtime_error if writing fails.
+         */
+        void save(std::ostream &stream);
+
+        /**
+         * Restores a tree written by {@link save}. The file is mapped into memory and its nodes are used in place, loading only hashes the polyhedron and validates the nodes.
+         * The loaded tree is frozen and has no nodes besides its flat representation, see {@link getRootNode}.
+         * @param path The path of the file to read.
+         * @param vertices The vertex coordinates of the polyhedron the tree has been built for.
+         * @param faces The faces of the polyhedron the tree has been built for.
+         * @return the loaded tree.
+         * @throws std::runtime_error if the file cannot be read or is not a compatible KDTree file.
+         * @throws std::invalid_argument if the file belongs to a different polyhedron.
+         */
+        static KDTree load(const std::string &path, const std::vector<Array3> &vertices, const std::vector<IndexArray3> &faces);
+
+        /**
+         * Restores a tree written by {@link save(std::ostream &)} from a stream. The content is copied instead of mapped.
+         * @param stream The stream to read from, has to be opened in binary mode.
+         * @param vertices The vertex coordinates of the polyhedron the tree has been built for.
+         * @param faces The faces of the polyhedron the tree has been built for.
+         * @return the loaded tree.
+         * @throws std::runtime_error if the stream cannot be read or does not contain a compatible KDTree.
+         * @throws std::invalid_argument if the stream belongs to a different polyhedron.
+         */
+        static KDTree load(std::istream &stream, const std::vector<Array3> &vertices, const std::vector<IndexArray3> &faces);
+
+        /**
+         * @return the polyhedron's vertices.
+         */
+        [[nodiscard]] const std::vector<Array3> &getVertices() const;
+
+        /**
+         * @return the polyhedron's faces.
+         */
+        [[nodiscard]] const std::vector<IndexArray3> &getFaces() const;
+
         friend std::ostream &operator<<(std::ostream &os, const KDTree &kdTree);
+
+    private:
+        /**
+         * Creates a frozen tree from a binary image written by {@link save}.
+         * @param vertices The vertex coordinates of the polyhedron.
+         * @param faces The faces of the polyhedron.
+         * @param image The image, whose nodes are used in place.
+         */
+        KDTree(std::vector<Array3> vertices, std::vector<IndexArray3> faces, util::MappedFile &&image);
+
+        /**
+         * The ray direction used by {@link isInside}. It is not aligned with any axis or diagonal, so that it rarely lies in the plane of a face.
+         */
+        static constexpr Array3 INSIDE_TEST_RAY{1.0, 0.7548776662466927, 0.5698402909980532};
+
+        /**
+         * Nodes up to this depth build their two subtrees as parallel tasks during {@link prebuildTree}, resulting in up to 2^PARALLEL_BUILD_DEPTH tasks.
+         */
+        static constexpr size_t PARALLEL_BUILD_DEPTH{10};
+
+        /**
+         * Recursively builds all nodes below the given node.
+         * @param node The root of the subtree to build.
+         * @param depth The depth of the node in the tree.
+         */
+        static void buildSubtree(TreeNode *node, size_t depth);
+
+        /**
+         * Collects the intersection points of a ray and the polyhedron's faces in the context's intersection buffer.
+         * @param origin The point where the ray originates from.
+         * @param ray Specifies the ray direction.
+         * @param context The scratch memory of the query.
+         * @return the intersection buffer of the context. Points on edges shared by several faces may be contained multiple times.
+         */
+        const std::vector<Array3> &collectFaceIntersections(const Array3 &origin, const Array3 &ray, QueryContext &context);
+
+        /**
+         * Evicts cold subtrees until the tree fits its memory budget again, if no other thread accesses the lazily built nodes.
+         */
+        void evictIfOverBudget();
+
+        /**
+         * Returns the flat representation of the tree, building and freezing the whole tree first if necessary.
+         * @return the {@link FlatTree}.
+         */
+        const FlatTree &getFlatTree();
     };
 } // namespace kdtree
@@ -1,5 +1,7 @@
 #include "KDTree/tree/KdDefinitions.h"
 
+#include "KDTree/tree/FaceMarker.h"
+
 namespace kdtree {
     Array3 normal(const Direction direction) {
         switch (direction) {
@@ -60,6 +62,13 @@ namespace kdtree {
         return std::isnan(t) ? 0.0 : t;
     }
 
+    DoubleBatch Plane::rayPlaneIntersection(const BatchArray3 &origin, const BatchArray3 &inverseRay) const {
+        const DoubleBatch t = (DoubleBatch(this->axisCoordinate) - origin[static_cast<int>(orientation)]) *
+                              inverseRay[static_cast<int>(orientation)];
+        //same handling of parallel rays as in the scalar version
+        return xsimd::select(xsimd::isnan(t), DoubleBatch(0.0), t);
+    }
+
 
     bool Plane::operator==(const Plane &other) const {
         return std::fabs(axisCoordinate - other.axisCoordinate) < 1e-15 && orientation == other.orientation;
@@ -112,6 +121,21 @@ namespace kdtree {
         return {t_enter, t_exit};
     }
 
+    std::pair<DoubleBatch, DoubleBatch> Box::rayBoxIntersection(const BatchArray3 &origin,
+                                                                const BatchArray3 &inverseRay) const {
+        DoubleBatch t_enter{-std::numeric_limits<double>::infinity()};
+        DoubleBatch t_exit{std::numeric_limits<double>::infinity()};
+        for (const auto &direction: ALL_DIRECTIONS) {
+            const DoubleBatch t_min = Plane(minPoint, direction).rayPlaneIntersection(origin, inverseRay);
+            const DoubleBatch t_max = Plane(maxPoint, direction).rayPlaneIntersection(origin, inverseRay);
+            //rays shot in negative direction hit the max point slab first
+            const BoolBatch negative = inverseRay[static_cast<size_t>(direction)] < DoubleBatch(0.0);
+            t_enter = xsimd::max(t_enter, xsimd::select(negative, t_max, t_min));
+            t_exit = xsimd::min(t_exit, xsimd::select(negative, t_min, t_max));
+        }
+        return {t_enter, t_exit};
+    }
+
     double Box::surfaceArea() const {
         const double width = std::abs(maxPoint[0] - minPoint[0]);
         const double length = std::abs(maxPoint[1] - minPoint[1]);
@@ -131,28 +155,61 @@ namespace kdtree {
     }
 
     std::vector<Array3> Box::clipToVoxel(const std::array<Array3, 3> &points) const {
-        using namespace util;
-        //use clipped as the input vector because the inner for loop swaps input and clipped each iteration,
+        const ClippedPolygon clipped{clipPolygon(points)};
+        return {clipped.vertices.cbegin(), clipped.vertices.cbegin() + clipped.size};
+    }
+
+    std::optional<Box> Box::clipToVoxelBounds(const std::array<Array3, 3> &points) const {
+        const Box faceBox{getBoundingBox(points)};
+        bool inside{true};
+        for (size_t dimension = 0; dimension < DIMENSIONS; ++dimension) {
+            //all vertices lie outside of one of the box's planes -> nothing remains after clipping
+            if (faceBox.maxPoint[dimension] < minPoint[dimension] || faceBox.minPoint[dimension] > maxPoint[dimension]) {
+                return std::nullopt;
+            }
+            inside &= minPoint[dimension] <= faceBox.minPoint[dimension] && faceBox.maxPoint[dimension] <= maxPoint[dimension];
+        }
+        //all vertices lie in the box -> clipping would not change them
+        if (inside) {
+            return faceBox;
+        }
+        const ClippedPolygon clipped{clipPolygon(points)};
+        if (clipped.size == 0) {
+            return std::nullopt;
+        }
+        Box clippedBox{std::make_pair(clipped.vertices[0], clipped.vertices[0])};
+        for (size_t i = 1; i < clipped.size; ++i) {
+            for (size_t dimension = 0; dimension < DIMENSIONS; ++dimension) {
+                clippedBox.minPoint[dimension] = std::min(clippedBox.minPoint[dimension], clipped.vertices[i][dimension]);
+                clippedBox.maxPoint[dimension] = std::max(clippedBox.maxPoint[dimension], clipped.vertices[i][dimension]);
+            }
+        }
+        return clippedBox;
+    }
+
+    Box::ClippedPolygon Box::clipPolygon(const std::array<Array3, 3> &points) const {
+        //use clipped as the input polygon because the inner for loop swaps input and clipped each iteration,
         //since each iteration needs the output of the previous iteration as input.
-        std::vector clipped(points.cbegin(), points.cend());
-        std::vector<Array3> input{};
-        input.reserve(points.size());
+        ClippedPolygon clipped{};
+        std::copy(points.cbegin(), points.cend(), clipped.vertices.begin());
+        clipped.size = points.size();
+        ClippedPolygon input{};
         //every plane defined by the maxPoint has to flip its normal because the normals have to point inside the bounding box.
         bool flipPlane = false;
         for (const Direction direction: ALL_DIRECTIONS) {
             const auto directionPlanes = {Plane(minPoint, direction), Plane(maxPoint, direction)};
             for (const auto &plane: directionPlanes) {
                 std::swap(input, clipped);
+                clipped.size = 0;
                 clipToVoxelPlane(plane, flipPlane, input, clipped);
-                input.clear();
                 flipPlane = !flipPlane;
             }
         }
         return clipped;
     }
 
-    void Box::clipToVoxelPlane(const Plane &plane, const bool flipPlaneNormal, const std::vector<Array3> &source,
-                               std::vector<Array3> &dest) {
+    void Box::clipToVoxelPlane(const Plane &plane, const bool flipPlaneNormal, const ClippedPolygon &source,
+                               ClippedPolygon &dest) {
         using namespace util;
         //the distance is interpreted in the normal direction, negative values are in opposite direction of the normal.
         auto distanceMeasures = [&plane, &flipPlaneNormal](
@@ -170,19 +227,22 @@ namespace kdtree {
             const double t{distanceTo / (distanceTo - distanceFrom)};
             return from * t + to * (1.0 - t);
         };
-        for (size_t i{0}; i < source.size(); i++) {
-            const Array3 &from{source[i]};
-            const Array3 &to{source[(i + 1) % source.size()]};
+        const auto push = [&dest](const Array3 &vertex) {
+            dest.vertices[dest.size++] = vertex;
+        };
+        for (size_t i{0}; i < source.size; i++) {
+            const Array3 &from{source.vertices[i]};
+            const Array3 &to{source.vertices[(i + 1) % source.size]};
             // $ (from - origin) * normal = cos alpha * |from - origin| * |normal| = cos alpha * |from - origin| * 1 $ ^= distance of from to the plane in the direction of the normal.
             const auto distanceFrom = distanceMeasures(from);
             const auto distanceTo = distanceMeasures(to);
             if (isInside(distanceFrom) && isInside(distanceTo)) {
-                dest.push_back(to);
+                push(to);
             } else if (isInside(distanceFrom) && !isInside(distanceTo)) {
-                dest.emplace_back(intersectionPoint(from, to, distanceFrom, distanceTo));
+                push(intersectionPoint(from, to, distanceFrom, distanceTo));
             } else if (!isInside(distanceFrom) && isInside(distanceTo)) {
-                dest.emplace_back(intersectionPoint(from, to, distanceFrom, distanceTo));
-                dest.push_back(to);
+                push(intersectionPoint(from, to, distanceFrom, distanceTo));
+                push(to);
             } else if (!isInside(distanceFrom) && !isInside(distanceTo)) {
                 //do nothing
             }
@@ -191,21 +251,52 @@ namespace kdtree {
 
 
     PlaneEvent::PlaneEvent(const PlaneEventType type, const Plane plane, const unsigned faceIndex)
-        : type{type}, plane{plane}, faceIndex{faceIndex} {
+        : key{toKey(plane.axisCoordinate)}, faceIndex{faceIndex},
+          tag{static_cast<uint32_t>(plane.orientation) * 3 + static_cast<uint32_t>(type)} {
+    }
+
+    PlaneEventType PlaneEvent::type() const {
+        return static_cast<PlaneEventType>(tag % 3);
+    }
+
+    Plane PlaneEvent::plane() const {
+        return {fromKey(key), orientation()};
+    }
+
+    Direction PlaneEvent::orientation() const {
+        return static_cast<Direction>(tag / 3);
+    }
+
+    uint64_t PlaneEvent::toKey(const double coordinate) {
+        //adding zero turns -0.0 into 0.0, so that both compare equal like the floating point values
+        const double normalized{coordinate + 0.0};
+        uint64_t bits{};
+        std::memcpy(&bits, &normalized, sizeof(bits));
+        //negative values are ordered reversely -> flip all bits, positive values are flipped in the sign bit only to order them after the negative ones
+        constexpr uint64_t signBit{uint64_t{1} << 63};
+        return bits & signBit ? ~bits : bits | signBit;
+    }
+
+    double PlaneEvent::fromKey(const uint64_t key) {
+        constexpr uint64_t signBit{uint64_t{1} << 63};
+        const uint64_t bits{key & signBit ? key & ~signBit : ~key};
+        double coordinate{};
+        std::memcpy(&coordinate, &bits, sizeof(coordinate));
+        return coordinate;
     }
 
     bool PlaneEvent::operator<(const PlaneEvent &other) const {
-        if (this->plane.axisCoordinate != other.plane.axisCoordinate) {
-            return this->plane.axisCoordinate < other.plane.axisCoordinate;
-        }
-        if (this->plane.orientation == other.plane.orientation) {
-            return this->type < other.type;
+        //axis major order: orientation, then coordinate, then PlaneEventType
+        const uint32_t orientation{tag / 3};
+        const uint32_t otherOrientation{other.tag / 3};
+        if (orientation != otherOrientation) {
+            return orientation < otherOrientation;
         }
-        return static_cast<unsigned>(this->plane.orientation) < static_cast<unsigned>(other.plane.orientation);
+        return key < other.key || (key == other.key && tag < other.tag);
     }
 
     bool PlaneEvent::operator==(const PlaneEvent &other) const {
-        return type == other.type && plane == other.plane && faceIndex == other.faceIndex;
+        return key == other.key && tag == other.tag && faceIndex == other.faceIndex;
     }
 
     TriangleIndexVector convertEventsToFaces(const std::variant<TriangleIndexVector, PlaneEventVector> &events) {
@@ -213,14 +304,13 @@ namespace kdtree {
             return std::get<TriangleIndexVector>(events);
         }
         const auto &eventList{std::get<PlaneEventVector>(events)};
-        TriangleIndexVector triangles{};
+        TriangleIndexVector triangles{eventList.get_allocator()};
         triangles.reserve(eventList.size());
         //used to avoid duplication
-        std::unordered_set<size_t> processedFaces{};
+        const FaceMarker::Lease processedFaces{FaceMarker::acquire()};
         auto insertIfAbsent = [&triangles, &processedFaces](const auto &planeEvent) {
             const auto faceIndex{planeEvent.faceIndex};
-            if (processedFaces.find(faceIndex) == processedFaces.end()) {
-                processedFaces.insert(faceIndex);
+            if (processedFaces->insert(faceIndex)) {
                 triangles.push_back(faceIndex);
             }
         };
@@ -235,14 +325,11 @@ namespace kdtree {
                                   return indexList.size();
                               },
                               [](const PlaneEventVector &eventList) {
-                                  std::mutex writeLock{};
                                   size_t count{0};
-                                  std::unordered_set<size_t> processedFaces{};
+                                  const FaceMarker::Lease processedFaces{FaceMarker::acquire()};
                                   std::for_each(eventList.cbegin(), eventList.cend(),
-                                                [&processedFaces, &count, &writeLock](const auto &planeEvent) {
-                                                    if (processedFaces.find(planeEvent.faceIndex) == processedFaces.
-                                                        end()) {
-                                                        processedFaces.insert(planeEvent.faceIndex);
+                                                [&processedFaces, &count](const auto &planeEvent) {
+                                                    if (processedFaces->insert(planeEvent.faceIndex)) {
                                                         count++;
                                                     }
                                                 });
@@ -4,16 +4,21 @@
 #include "thrust/detail/execution_policy.h"
 #include "thrust/execution_policy.h"
 #include "thrust/system/detail/sequential/for_each.h"
+#include "xsimd/xsimd.hpp"
 
 #include <algorithm>
 #include <array>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <initializer_list>
 #include <iterator>
+#include <limits>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
+#include <optional>
 #include <stdexcept>
 #include <thrust/execution_policy.h>
 #include <thrust/for_each.h>
@@ -43,6 +48,27 @@ namespace kdtree {
      */
     using Array3Triplet = std::array<Array3, 3>;
 
+    /**
+     * Alias for a SIMD register of doubles, holding one value per ray of a ray packet.
+     */
+    using DoubleBatch = xsimd::batch<double>;
+
+    /**
+     * Alias for a SIMD register of booleans, used to mask the rays of a ray packet.
+     */
+    using BoolBatch = xsimd::batch_bool<double>;
+
+    /**
+     * Alias for an array of size 3 (DoubleBatch)
+     * @example for the x, y, z coordinates of all rays in a ray packet.
+     */
+    using BatchArray3 = std::array<DoubleBatch, 3>;
+
+    /**
+     * The number of rays traversed together in a ray packet. Corresponds to the SIMD width of the target architecture.
+     */
+    constexpr size_t PACKET_SIZE = DoubleBatch::size;
+
     /**
      * Assigns an integer index to the coordinate axes
      *
@@ -106,6 +132,14 @@ namespace kdtree {
         */
         [[nodiscard]] double rayPlaneIntersection(const Array3 &origin, const Array3 &inverseRay) const;
 
+        /**
+        * Intersects a packet of rays with the splitPlane.
+        * @param origin The points where the rays originate from.
+        * @param inverseRay The inverse ray direction vectors of the rays to be intersected.
+        * @return Returns the t parameter for each ray, see {@link rayPlaneIntersection}.
+        */
+        [[nodiscard]] DoubleBatch rayPlaneIntersection(const BatchArray3 &origin, const BatchArray3 &inverseRay) const;
+
         /**
         * Equality operator used for testing purposes
         */
@@ -144,6 +178,15 @@ namespace kdtree {
          */
         [[nodiscard]] std::pair<double, double> rayBoxIntersection(const Array3 &origin, const Array3 &inverseRay) const;
 
+        /**
+         * Calculates the intersection points of a packet of rays and a box.
+         * @param origin The origins of the rays.
+         * @param inverseRay The inverse ray direction vectors of the rays to be intersected.
+         * @return Parameters t of the entry and exit intersection points for each ray.
+         */
+        [[nodiscard]] std::pair<DoubleBatch, DoubleBatch> rayBoxIntersection(const BatchArray3 &origin,
+                                                                             const BatchArray3 &inverseRay) const;
+
         /**
         * Calculates the surface area of a box.
         * @return the surface area
@@ -176,10 +219,40 @@ namespace kdtree {
         */
         [[nodiscard]] std::vector<Array3> clipToVoxel(const std::array<Array3, 3> &points) const;
 
+        /**
+        * Clips a face to this box like {@link clipToVoxel}, but only returns the bounding box of the clipped face, which is all the split plane algorithms need. No memory is allocated.
+        * Faces whose bounding box lies inside this box are not clipped at all, faces lying entirely outside of one of the box's planes are rejected without clipping.
+        * @param points The corner points of the face to be clipped.
+        * @return The bounding box of the clipped face or std::nullopt if no part of the face lies in this box.
+        */
+        [[nodiscard]] std::optional<Box> clipToVoxelBounds(const std::array<Array3, 3> &points) const;
+
         explicit Box(const std::pair<Array3, Array3> &pair);
         Box();
 
     private:
+        /**
+         * Each of the six planes of a box adds at most one vertex to an exactly clipped triangle. Rounding the interpolated vertices can make the clipped polygon
+         * slightly non convex though, e.g. for faces lying in a plane of the box, and a plane crossing k edges of a polygon pairwise adds up to k vertices.
+         * A polygon of n vertices thus grows to at most n + n / 2 vertices per plane: 3, 4, 6, 9, 13, 19, 28.
+         */
+        constexpr static size_t MAX_CLIPPED_VERTICES{28};
+
+        /**
+         * A polygon of fixed capacity, which holds a triangle clipped to a box.
+         */
+        struct ClippedPolygon {
+            std::array<Array3, MAX_CLIPPED_VERTICES> vertices;
+            size_t size;
+        };
+
+        /**
+         * Clips a face to this box using the Sutherland-Hodgman-Algorithm.
+         * @param points The corner points of the face to be clipped.
+         * @return The corner points of the clipped face.
+         */
+        [[nodiscard]] ClippedPolygon clipPolygon(const std::array<Array3, 3> &points) const;
+
         /**
          * Takes a plane and a set of vertices and clips them accordingly.
          * Used as a sub procedure by the Sutherland-Hodgman-Algorithm.
@@ -188,13 +261,14 @@ namespace kdtree {
          * @param source The vertices to be transformed to lie on the inside of the plane.
          * @param dest The transformed vertices.
          */
-        static void clipToVoxelPlane(const Plane &plane, bool flipPlaneNormal, const std::vector<Array3> &source, std::vector<Array3> &dest);
+        static void clipToVoxelPlane(const Plane &plane, bool flipPlaneNormal, const ClippedPolygon &source, ClippedPolygon &dest);
     };
 
     /**
      * A set that stores indices of the faces vector in the KDTree. This effectively corresponds to a set of triangles. For performance purposes a std::vector is used instead of a std::set.
+     * The lists are allocated from the {@link NodeArena} of the tree they belong to.
      */
-    using TriangleIndexVector = std::vector<size_t>;
+    using TriangleIndexVector = std::pmr::vector<size_t>;
 
     /**
     * Triangle sets contained in an array. Used by the KDTree to divide a bounding boxes included triangles into smaller subsets. For the semantic purpose of the contained sets please refer to the comments in the usage context.
@@ -213,22 +287,59 @@ namespace kdtree {
 
     /**
      * Generated when traversing the vector of faces and building their candidate planes.
+     * The event is stored in 16 bytes: The candidate plane's coordinate is kept as an order preserving 64-bit key, its orientation and the PlaneEventType are packed into a tag.
+     * Events are sorted by orientation, coordinate and PlaneEventType, so that a sorted list consists of one contiguous stream per axis. All three criteria are small integers, which allows radix sorting the events.
      */
     struct PlaneEvent {
-        PlaneEventType type;
         /**
-         * The candidate plane suggested by the face included in this struct.
+         * The bits of the candidate plane's coordinate, transformed such that the unsigned integer order equals the floating point order.
          */
-        Plane plane;
+        uint64_t key;
         /**
          * The index of the face that generated this candidate plane.
          */
         unsigned int faceIndex;
+        /**
+         * The orientation of the candidate plane and the PlaneEventType, encoded as $ orientation * 3 + type $.
+         */
+        uint32_t tag;
 
         PlaneEvent(PlaneEventType type, Plane plane, unsigned faceIndex);
 
         PlaneEvent() = default;
 
+        /**
+         * Returns the position of the face that generated this event relative to the candidate plane.
+         * @return the PlaneEventType.
+         */
+        [[nodiscard]] PlaneEventType type() const;
+
+        /**
+         * Returns the candidate plane suggested by the face included in this struct.
+         * @return the candidate plane.
+         */
+        [[nodiscard]] Plane plane() const;
+
+        /**
+         * Returns the orientation of the candidate plane without decoding its coordinate.
+         * @return the orientation of the candidate plane.
+         */
+        [[nodiscard]] Direction orientation() const;
+
+        /**
+         * Transforms a coordinate to an unsigned integer preserving its order. Both zeros are mapped to the same key.
+         * @param coordinate The coordinate to transform.
+         * @return the key of the coordinate.
+         */
+        static uint64_t toKey(double coordinate);
+
+        /**
+         * Inverse of {@link toKey}.
+         * @param key The key to transform back.
+         * @return the coordinate of the key.
+         */
+        static double fromKey(uint64_t key);
+
         /**
          * Less operator used for sorting an PlaneEvent vector.
          * @param other the PlaneEvent to compare this to.
@@ -243,9 +354,11 @@ namespace kdtree {
     };
 
     /**
-     * A list of PlaneEvents.
+     * A list of PlaneEvents. The lists are allocated from the {@link NodeArena} of the tree they belong to.
     */
-    using PlaneEventVector = std::vector<PlaneEvent>;
+    using PlaneEventVector = std::pmr::vector<PlaneEvent>;
+
+    static_assert(sizeof(PlaneEvent) == 16, "PlaneEvent is expected to be packed into 16 bytes");
 
     /**
     * An array of PlaneEventLists.
@@ -271,7 +384,7 @@ namespace kdtree {
         * @param faces the faces vector to lookup face indices.
         * @return pair of transform iterators.
         */
-    [[nodiscard]] static auto transformIterator(const std::vector<size_t>::const_iterator begin, const std::vector<size_t>::const_iterator end, const std::vector<Array3> &vertices, const std::vector<IndexArray3> &faces) {
+    [[nodiscard]] static auto transformIterator(const TriangleIndexVector::const_iterator begin, const TriangleIndexVector::const_iterator end, const std::vector<Array3> &vertices, const std::vector<IndexArray3> &faces) {
         //The offset must be captured by value to ensure its lifetime!
         const auto lambdaApplication = [&vertices, &faces](size_t faceIndex) {
             const auto &face = faces[faceIndex];
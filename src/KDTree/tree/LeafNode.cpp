@@ -1,20 +1,14 @@
 #include "KDTree/tree/LeafNode.h"
 
 namespace kdtree {
-    LeafNode::LeafNode(const SplitParam &splitParam, const size_t nodeId)
-        : TreeNode(splitParam, nodeId) {
+    LeafNode::LeafNode(SplitParam &&splitParam, const size_t nodeId)
+        : TreeNode(std::move(splitParam), nodeId) {
     }
 
     void LeafNode::getFaceIntersections(const Array3 &origin, const Array3 &ray,
-                                        std::set<Array3> &intersections) {
-        if (std::holds_alternative<PlaneEventVector>(_splitParam->boundFaces)) {
-            std::call_once(convertedToFace, [this]() {
-                _splitParam->boundFaces = convertEventsToFaces(std::get<PlaneEventVector>(_splitParam->boundFaces));
-            });
-        }
+                                        std::vector<Array3> &intersections) {
         std::mutex writeLock{};
-        const TriangleIndexVector &boundTriangles{std::get<TriangleIndexVector>(_splitParam->boundFaces)};
-        std::vector<Array3> results(boundTriangles.size());
+        const TriangleIndexVector &boundTriangles{getBoundFaces()};
         //traverses all contained faces and performs intersection tests with them -> store results in the buffer passed in the arguments
         thrust::for_each(thrust::device, boundTriangles.cbegin(), boundTriangles.cend(),
                          [this, &ray, &origin, &intersections, &writeLock](const size_t faceIndex) {
@@ -22,11 +16,20 @@ namespace kdtree {
                                  origin, ray, _splitParam->faces[faceIndex]);
                              if (intersection.has_value()) {
                                  std::unique_lock lock(writeLock);
-                                 intersections.insert(intersection.value());
+                                 intersections.push_back(intersection.value());
                              }
                          });
     }
 
+    const TriangleIndexVector &LeafNode::getBoundFaces() {
+        std::call_once(convertedToFace, [this]() {
+            if (std::holds_alternative<PlaneEventVector>(_splitParam->boundFaces)) {
+                _splitParam->boundFaces = convertEventsToFaces(std::get<PlaneEventVector>(_splitParam->boundFaces));
+            }
+        });
+        return std::get<TriangleIndexVector>(_splitParam->boundFaces);
+    }
+
     std::optional<Array3> LeafNode::rayIntersectsTriangle(const Array3 &rayOrigin, const Array3 &rayVector,
                                                           const IndexArray3 &triangleVertexIndex) const {
         Array3Triplet edgeVertices{};
@@ -40,6 +43,16 @@ namespace kdtree {
 
     std::optional<Array3> LeafNode::rayIntersectsTriangle(const Array3 &rayOrigin, const Array3 &rayVector,
                                                           const Array3Triplet &triangleVertices) {
+        using namespace util;
+        const std::optional<double> t = rayTriangleIntersection(rayOrigin, rayVector, triangleVertices);
+        if (t.has_value()) {
+            return rayOrigin + rayVector * t.value();
+        }
+        return std::nullopt;
+    }
+
+    std::optional<double> LeafNode::rayTriangleIntersection(const Array3 &rayOrigin, const Array3 &rayVector,
+                                                            const Array3Triplet &triangleVertices) {
         // Adapted Möller–Trumbore intersection algorithm
         // see https://en.wikipedia.org/wiki/Möller–Trumbore_intersection_algorithm
         using namespace kdtree;
@@ -67,7 +80,98 @@ namespace kdtree {
 
         const double t = f * dot(edge2, q);
         if (t > EPSILON_ZERO_OFFSET) {
-            return rayOrigin + rayVector * t;
+            return t;
+        }
+        return std::nullopt;
+    }
+
+    std::pair<BoolBatch, DoubleBatch> LeafNode::rayTriangleIntersection(const BatchArray3 &rayOrigin,
+                                                                        const BatchArray3 &rayVector,
+                                                                        const BatchArray3 &vertex0,
+                                                                        const BatchArray3 &edge1,
+                                                                        const BatchArray3 &edge2) {
+        // the same steps as the scalar version, but the early exits are replaced by masks
+        using namespace kdtree;
+        using namespace util;
+        const BatchArray3 h = cross(rayVector, edge2);
+        const DoubleBatch a = dot(edge1, h);
+        const BoolBatch parallel = (a > DoubleBatch(-EPSILON_ZERO_OFFSET)) & (a < DoubleBatch(EPSILON_ZERO_OFFSET));
+
+        const DoubleBatch f = DoubleBatch(1.0) / a;
+        const BatchArray3 s = rayOrigin - vertex0;
+        const DoubleBatch u = f * dot(s, h);
+        const BoolBatch outsideU = (u < DoubleBatch(0.0)) | (u > DoubleBatch(1.0));
+
+        const BatchArray3 q = cross(s, edge1);
+        const DoubleBatch v = f * dot(rayVector, q);
+        const BoolBatch outsideV = (v < DoubleBatch(0.0)) | (u + v > DoubleBatch(1.0));
+
+        const DoubleBatch t = f * dot(edge2, q);
+        return {~(parallel | outsideU | outsideV) & (t > DoubleBatch(EPSILON_ZERO_OFFSET)), t};
+    }
+
+    ShearedRay LeafNode::shearRay(const Array3 &rayOrigin, const Array3 &rayVector) {
+        //the dimension in which the ray direction is maximal becomes the z axis
+        const Array3 absoluteRay{std::abs(rayVector[0]), std::abs(rayVector[1]), std::abs(rayVector[2])};
+        const size_t kz{static_cast<size_t>(std::max_element(absoluteRay.cbegin(), absoluteRay.cend()) - absoluteRay.cbegin())};
+        size_t kx{(kz + 1) % DIMENSIONS};
+        size_t ky{(kx + 1) % DIMENSIONS};
+        //swap x and y to preserve the winding direction of the faces
+        if (rayVector[kz] < 0.0) {
+            std::swap(kx, ky);
+        }
+        return {rayOrigin, {kx, ky, kz}, {rayVector[kx] / rayVector[kz], rayVector[ky] / rayVector[kz], 1.0 / rayVector[kz]}};
+    }
+
+    std::optional<double> LeafNode::watertightRayTriangleIntersection(const ShearedRay &ray,
+                                                                      const Array3Triplet &triangleVertices,
+                                                                      const IndexArray3 &triangleVertexIndex) {
+        // Watertight ray/triangle intersection, see Woop, Benthin, Wald: "Watertight Ray/Triangle Intersection", JCGT 2(1), 2013
+        using namespace util;
+        const auto [kx, ky, kz] = ray.axes;
+        const auto [sx, sy, sz] = ray.shear;
+        //the vertices in ray space, a vertex is transformed to the same coordinates for all faces it belongs to
+        std::array<std::array<double, 2>, 3> projected{};
+        Array3 z{};
+        for (size_t i = 0; i < 3; ++i) {
+            const Array3 vertex{triangleVertices[i] - ray.origin};
+            projected[i] = {vertex[kx] - sx * vertex[kz], vertex[ky] - sy * vertex[kz]};
+            z[i] = sz * vertex[kz];
+        }
+        //2D cross product of the edge's endpoints, evaluated in the order of the vertex indices, so that the two faces of an edge obtain exactly negated values
+        const auto edgeFunction = [&projected, &triangleVertexIndex](const size_t from, const size_t to) {
+            if (triangleVertexIndex[from] < triangleVertexIndex[to]) {
+                return projected[from][0] * projected[to][1] - projected[from][1] * projected[to][0];
+            }
+            return -(projected[to][0] * projected[from][1] - projected[to][1] * projected[from][0]);
+        };
+        //each edge function belongs to the edge opposite of the vertex it weights
+        constexpr std::array<std::pair<size_t, size_t>, 3> edges{{{2, 1}, {0, 2}, {1, 0}}};
+        const Array3 weights{edgeFunction(2, 1), edgeFunction(0, 2), edgeFunction(1, 0)};
+        const double determinant{weights[0] + weights[1] + weights[2]};
+        //the ray is parallel to the face
+        if (determinant == 0.0) {
+            return std::nullopt;
+        }
+        const double orientation{determinant > 0.0 ? 1.0 : -1.0};
+        for (size_t i = 0; i < 3; ++i) {
+            const double weight{weights[i] * orientation};
+            if (weight < 0.0) {
+                return std::nullopt;
+            }
+            //the ray hits the edge -> only the face for which the edge is a top-left edge is hit
+            if (weight == 0.0) {
+                const auto [from, to] = orientation > 0.0 ? edges[i] : std::make_pair(edges[i].second, edges[i].first);
+                const double dx{projected[to][0] - projected[from][0]};
+                const double dy{projected[to][1] - projected[from][1]};
+                if (!(dy > 0.0 || (dy == 0.0 && dx > 0.0))) {
+                    return std::nullopt;
+                }
+            }
+        }
+        const double t{(weights[0] * z[0] + weights[1] * z[1] + weights[2] * z[2]) / determinant};
+        if (t > EPSILON_ZERO_OFFSET) {
+            return t;
         }
         return std::nullopt;
     }
@@ -19,6 +19,7 @@
 #include <ostream>
 #include <set>
 #include <string>
+#include <utility>
 #include <sstream>
 #include <variant>
 #include <vector>
@@ -26,6 +27,24 @@
 namespace kdtree {
 struct SplitParam;
 
+    /**
+     * A ray transformed for the watertight intersection test, precomputed once per ray. The ray space has its origin in the ray's origin and its z axis along the ray direction.
+     */
+    struct ShearedRay {
+        /**
+         * The point where the ray originates from.
+         */
+        Array3 origin;
+        /**
+         * The axes kx, ky and kz of the ray space, kz being the dimension in which the ray direction is maximal.
+         */
+        std::array<size_t, DIMENSIONS> axes;
+        /**
+         * The shear constants Sx, Sy and Sz, which transform the ray direction onto the unit z axis.
+         */
+        Array3 shear;
+    };
+
     /**
      * A TreeNode contained in a KDTree that doesn't split the spatial hierarchy any further. Intersection tests are directly performed on the contained triangles here.
      */
@@ -33,43 +52,94 @@ struct SplitParam;
     public:
         /**
          * Takes parameters from the parent node and stores them for later intersection tests.
-         * @param splitParam Parameters produced during the split that resulted in the creation of this node.
+         * @param splitParam Parameters produced during the split that resulted in the creation of this node, moved into the node.
          * @param nodeId Unique Id given by the TreeNodeFactory.
          */
-        explicit LeafNode(const SplitParam &splitParam, size_t nodeId);
+        explicit LeafNode(SplitParam &&splitParam, size_t nodeId);
 
         /**
         * Used to calculated intersections of a ray and the polyhedron's faces contained in this node.
         * @param origin The point where the ray originates from.
         * @param ray Specifies the ray direction.
-        * @param intersections The set intersection points are added to.
+        * @param intersections The buffer intersection points are appended to.
         */
-        void getFaceIntersections(const Array3 &origin, const Array3 &ray, std::set<Array3> &intersections);
+        void getFaceIntersections(const Array3 &origin, const Array3 &ray, std::vector<Array3> &intersections);
 
-        [[nodiscard]] std::string toString() const override;
-
-        friend std::ostream &operator<<(std::ostream &os, const LeafNode &node);
+        /**
+         * Returns the indices of the faces contained in this node. PlaneEvents are converted to face indices on first access.
+         * @return the index list of the bound faces.
+         */
+        const TriangleIndexVector &getBoundFaces();
 
-    private:
         /**
          * Möller-Trumbore Algorithm for Ray-Face intersection.
          * @param rayOrigin The point where the ray originates from.
          * @param rayVector Specifies the ray direction.
-         * @param triangleVertexIndex the face to test against, described by the vertices that comprise it (passed by index reference).
-         * @return
+         * @param triangleVertices the face to test against, described by the vertices that comprise it (passed by value).
+         * @return the intersection point if the ray hits the face.
          */
-        [[nodiscard]] std::optional<Array3> rayIntersectsTriangle(const Array3 &rayOrigin, const Array3 &rayVector,
-                                                                  const IndexArray3 &triangleVertexIndex) const;
+        static std::optional<Array3> rayIntersectsTriangle(const Array3 &rayOrigin, const Array3 &rayVector,
+                                                           const Array3Triplet &triangleVertices);
 
         /**
          * Möller-Trumbore Algorithm for Ray-Face intersection.
          * @param rayOrigin The point where the ray originates from.
          * @param rayVector Specifies the ray direction.
          * @param triangleVertices the face to test against, described by the vertices that comprise it (passed by value).
+         * @return the parameter t of the equation $ intersection_point = rayOrigin + t * rayVector $ if the ray hits the face.
+         */
+        static std::optional<double> rayTriangleIntersection(const Array3 &rayOrigin, const Array3 &rayVector,
+                                                             const Array3Triplet &triangleVertices);
+
+        /**
+         * Möller-Trumbore Algorithm for Ray-Face intersection, performed for all lanes of the SIMD registers at once. The lanes either hold different rays or different faces, the other operand is broadcast to all lanes. Each lane yields the same result as the scalar version.
+         * @param rayOrigin The points where the rays originate from.
+         * @param rayVector Specifies the ray directions.
+         * @param vertex0 The first vertex of the faces.
+         * @param edge1 The edges from the first to the second vertex of the faces.
+         * @param edge2 The edges from the first to the third vertex of the faces.
+         * @return the mask of the lanes whose ray hits the face and the parameter t of the equation $ intersection_point = rayOrigin + t * rayVector $ for each lane.
+         */
+        static std::pair<BoolBatch, DoubleBatch> rayTriangleIntersection(const BatchArray3 &rayOrigin,
+                                                                         const BatchArray3 &rayVector,
+                                                                         const BatchArray3 &vertex0,
+                                                                         const BatchArray3 &edge1,
+                                                                         const BatchArray3 &edge2);
+
+        /**
+         * Transforms a ray for the use in {@link watertightRayTriangleIntersection}.
+         * @param rayOrigin The point where the ray originates from.
+         * @param rayVector Specifies the ray direction.
+         * @return the sheared ray.
+         */
+        static ShearedRay shearRay(const Array3 &rayOrigin, const Array3 &rayVector);
+
+        /**
+         * Watertight Ray-Face intersection by Woop et al. Rays hitting an edge or vertex shared by several faces of a closed and consistently oriented mesh hit exactly one of them,
+         * ties are broken by a top-left rule on the edges. Thus, counting the hits yields the number of times the ray crosses the surface.
+         * @param ray The ray transformed by {@link shearRay}.
+         * @param triangleVertices the face to test against, described by the vertices that comprise it.
+         * @param triangleVertexIndex the indices of the face's vertices, used to evaluate shared edges identically for all of their faces.
+         * @return the parameter t of the equation $ intersection_point = rayOrigin + t * rayVector $ if the ray hits the face.
+         */
+        static std::optional<double> watertightRayTriangleIntersection(const ShearedRay &ray,
+                                                                       const Array3Triplet &triangleVertices,
+                                                                       const IndexArray3 &triangleVertexIndex);
+
+        [[nodiscard]] std::string toString() const override;
+
+        friend std::ostream &operator<<(std::ostream &os, const LeafNode &node);
+
+    private:
+        /**
+         * Möller-Trumbore Algorithm for Ray-Face intersection.
+         * @param rayOrigin The point where the ray originates from.
+         * @param rayVector Specifies the ray direction.
+         * @param triangleVertexIndex the face to test against, described by the vertices that comprise it (passed by index reference).
          * @return
          */
-        static std::optional<Array3> rayIntersectsTriangle(const Array3 &rayOrigin, const Array3 &rayVector,
-                                                           const Array3Triplet &triangleVertices);
+        [[nodiscard]] std::optional<Array3> rayIntersectsTriangle(const Array3 &rayOrigin, const Array3 &rayVector,
+                                                                  const IndexArray3 &triangleVertexIndex) const;
 
         /**
          * Flags set when _splitParam boundFaces are converted from PlaneEvents to faces
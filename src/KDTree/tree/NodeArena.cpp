@@ -0,0 +1,22 @@
+#include "KDTree/tree/NodeArena.h"
+
+namespace kdtree {
+    size_t ArenaResource::bytesInUse() const {
+        return _bytesInUse.load(std::memory_order_relaxed);
+    }
+
+    void *ArenaResource::do_allocate(const size_t bytes, const size_t alignment) {
+        void *pointer{_pool.allocate(bytes, alignment)};
+        _bytesInUse.fetch_add(bytes, std::memory_order_relaxed);
+        return pointer;
+    }
+
+    void ArenaResource::do_deallocate(void *pointer, const size_t bytes, const size_t alignment) {
+        _pool.deallocate(pointer, bytes, alignment);
+        _bytesInUse.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    bool ArenaResource::do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+        return this == &other;
+    }
+} // namespace kdtree
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+
+namespace kdtree {
+
+    /**
+     * Blocks up to this size in bytes are served from the pools of a {@link NodeArena}, larger blocks are passed to the upstream resource.
+     */
+    constexpr size_t LARGEST_POOLED_BLOCK{1 << 16};
+
+    /**
+     * A thread safe pool resource, which keeps track of the bytes currently allocated from it.
+     */
+    class ArenaResource final : public std::pmr::memory_resource {
+        /**
+         * The pools the memory is taken from.
+         */
+        std::pmr::synchronized_pool_resource _pool{std::pmr::pool_options{0, LARGEST_POOLED_BLOCK}};
+
+        /**
+         * The amount of bytes allocated and not yet deallocated.
+         */
+        std::atomic_size_t _bytesInUse{0};
+
+    public:
+        /**
+         * @return the amount of bytes currently allocated from this resource.
+         */
+        [[nodiscard]] size_t bytesInUse() const;
+
+    private:
+        void *do_allocate(size_t bytes, size_t alignment) override;
+
+        void do_deallocate(void *pointer, size_t bytes, size_t alignment) override;
+
+        [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+    };
+
+    /**
+     * The memory resource of a KDTree. Nodes, their split parameters and the face lists handed to the child nodes are allocated from it.
+     * Small allocations are carved from large slabs, which are released in bulk once the tree and all of its nodes have been destroyed.
+     * Memory freed by nodes is reused for nodes built later. The resource is thread safe, so that subtrees can be built concurrently.
+     */
+    using NodeArena = std::shared_ptr<ArenaResource>;
+
+    /**
+     * Creates a new and empty arena for the nodes of a KDTree.
+     * @return the arena.
+     */
+    inline NodeArena createNodeArena() {
+        return std::make_shared<ArenaResource>();
+    }
+
+    /**
+     * Allocator for std::allocate_shared, which places a node and its control block in a {@link NodeArena}.
+     * Every copy of the allocator shares the ownership of the arena, so the arena outlives all nodes regardless of the order in which the tree and its nodes are destroyed.
+     * @tparam T The type of the allocated objects.
+     */
+    template<typename T>
+    class ArenaAllocator {
+        template<typename U>
+        friend class ArenaAllocator;
+
+        /**
+         * The arena the memory is taken from.
+         */
+        NodeArena _arena;
+
+    public:
+        using value_type = T;
+
+        /**
+         * Creates an allocator taking its memory from the given arena.
+         * @param arena The arena to allocate from.
+         */
+        explicit ArenaAllocator(NodeArena arena)
+            : _arena{std::move(arena)} {
+        }
+
+        template<typename U>
+        ArenaAllocator(const ArenaAllocator<U> &other) // NOLINT(*-explicit-constructor), required by the allocator requirements
+            : _arena{other._arena} {
+        }
+
+        T *allocate(const size_t n) {
+            return static_cast<T *>(_arena->allocate(n * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T *pointer, const size_t n) {
+            _arena->deallocate(pointer, n * sizeof(T), alignof(T));
+        }
+
+        template<typename U>
+        bool operator==(const ArenaAllocator<U> &other) const {
+            return _arena == other._arena;
+        }
+
+        template<typename U>
+        bool operator!=(const ArenaAllocator<U> &other) const {
+            return !(*this == other);
+        }
+    };
+} // namespace kdtree
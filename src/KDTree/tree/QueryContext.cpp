@@ -0,0 +1,15 @@
+#include "KDTree/tree/QueryContext.h"
+
+namespace kdtree {
+    QueryContext &QueryContext::threadLocal() {
+        thread_local QueryContext context{};
+        return context;
+    }
+
+    size_t QueryContext::removeDuplicates(std::vector<Array3> &points) {
+        //lexicographic ordering as used by std::set<Array3>, thus the same points are considered equal
+        std::sort(points.begin(), points.end());
+        points.erase(std::unique(points.begin(), points.end()), points.end());
+        return points.size();
+    }
+} // namespace kdtree
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "KDTree/tree/KdDefinitions.h"
+
+namespace kdtree {
+    //forward declaration
+    class TreeNode;
+
+    /**
+     * Scratch memory of ray queries. The buffers keep their capacity between queries, so that a context reused for repeated queries does not allocate memory in steady state.
+     * A context must not be used by several threads at the same time.
+     */
+    struct QueryContext {
+        /**
+         * The nodes still to visit during the traversal of the lazily built tree.
+         */
+        std::vector<TreeNode *> nodeStack;
+        /**
+         * The intersection points found by the last query. Points on edges shared by several faces may be contained multiple times.
+         */
+        std::vector<Array3> intersections;
+        /**
+         * The intersection points found by the last packet query, one buffer per ray of the packet.
+         */
+        std::array<std::vector<Array3>, PACKET_SIZE> packetIntersections;
+        /**
+         * The faces crossed by the last watertight query.
+         */
+        std::vector<uint32_t> crossedFaces;
+
+        /**
+         * Returns the context of the calling thread, which is used by the queries not taking a context.
+         * @return the thread local context.
+         */
+        static QueryContext &threadLocal();
+
+        /**
+         * Sorts the intersection points and removes duplicates, which result from rays hitting an edge or vertex shared by several faces.
+         * @param points The intersection points, modified in place.
+         * @return the number of distinct intersection points.
+         */
+        static size_t removeDuplicates(std::vector<Array3> &points);
+    };
+} // namespace kdtree
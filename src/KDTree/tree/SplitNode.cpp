@@ -1,46 +1,123 @@
 #include "KDTree/tree/SplitNode.h"
 
 namespace kdtree {
-    SplitNode::SplitNode(const SplitParam &splitParam, const Plane &plane,
-                         std::variant<TriangleIndexVectors<2>, PlaneEventVectors<2> > &triangleIndexLists,
-                         const size_t nodeId)
-        : TreeNode(splitParam, nodeId), _plane{plane}, _boundingBox{splitParam.boundingBox},
-          _triangleLists{std::move(triangleIndexLists)} {
+    SplitNode::SplitNode(SplitParam &&splitParam, const Plane &plane,
+                         std::variant<TriangleIndexVectors<2>, PlaneEventVectors<2> > &&triangleIndexLists,
+                         const std::array<size_t, 2> &childFaceCounts, const Box &contentBox, const size_t nodeId)
+        : TreeNode(std::move(splitParam), nodeId), _plane{plane}, _boundingBox{_splitParam->boundingBox}, _contentBox{contentBox},
+          _childFaces{
+              std::visit([](auto &typeLists) {
+                  return std::array<std::variant<TriangleIndexVector, PlaneEventVector>, 2>{
+                      std::move(*typeLists[0]), std::move(*typeLists[1])
+                  };
+              }, triangleIndexLists)
+          }, _childFaceCounts{childFaceCounts} {
+        //the faces of this node are distributed to the triangle lists -> only the lists are needed to build the children
+        _splitParam->boundFaces.emplace<TriangleIndexVector>(_splitParam->arena.get());
     }
 
-    std::shared_ptr<TreeNode> SplitNode::getChildNode(const size_t index) {
-        //create a reference to store the built node in
-        std::shared_ptr<TreeNode> &node = index == 0 ? _lesser : _greater;
-        //node is not yet built
-        std::call_once(childNodeCreated[index], [this, &node, &index] {
-            //copy parent param and modify to fit new node
-            SplitParam childParam{*_splitParam};
-            //get the bounding box after splitting;
-            auto [lesserBox, greaterBox] = this->_boundingBox.splitBox(this->_plane);
-            childParam.boundingBox = index == 0 ? lesserBox : greaterBox;
-            //get the triangles of the box
-            std::visit([&childParam, index](auto &typeLists) -> void {
-                childParam.boundFaces = *std::move(typeLists[index]);
-            }, _triangleLists);
-            childParam.splitDirection = static_cast<Direction>(
-                (static_cast<int>(_splitParam->splitDirection) + 1) % DIMENSIONS);
-            //increase the recursion depth of the direct child by 1
-            node = TreeNodeFactory::createTreeNode(childParam, 2 * nodeId + 1 + index);
-            if (_lesser != nullptr && _greater != nullptr) {
-                _splitParam.reset();
-            }
-        });
+    TreeNode *SplitNode::getChildNode(const size_t index) {
+        //the acquire load pairs with the release store below, the child is completely built once its pointer is visible
+        TreeNode *node{_children[index].load(std::memory_order_acquire)};
+        //node is not yet built, concurrent callers help with the parallel parts of the build and return once it is done
+        if (node == nullptr) {
+            _childBuild[index].callOnce([this, index] {
+                //get the bounding box after splitting;
+                auto [lesserBox, greaterBox] = this->_boundingBox.splitBox(this->_plane);
+                //move the triangles of the box out of this node, the emptied list is released right away
+                std::variant<TriangleIndexVector, PlaneEventVector> boundFaces{std::move(_childFaces[index])};
+                _childFaces[index].emplace<TriangleIndexVector>(_splitParam->arena.get());
+                //share the parent param and modify to fit new node
+                SplitParam childParam{
+                    *_splitParam, std::move(boundFaces), _childFaceCounts[index], index == 0 ? lesserBox : greaterBox,
+                    static_cast<Direction>((static_cast<int>(_splitParam->splitDirection) + 1) % DIMENSIONS)
+                };
+                //increase the recursion depth of the direct child by 1
+                _ownedChildren[index] = TreeNodeFactory::createTreeNode(std::move(childParam), 2 * nodeId + 1 + index);
+                _children[index].store(_ownedChildren[index].get(), std::memory_order_release);
+            });
+            node = _children[index].load(std::memory_order_acquire);
+        }
         return node;
     }
 
-    std::vector<std::shared_ptr<TreeNode> > SplitNode::getChildrenForIntersection(
+    bool SplitNode::isChildBuilt(const size_t index) const {
+        return _children[index].load(std::memory_order_relaxed) != nullptr;
+    }
+
+    bool SplitNode::markPrioritized() {
+        //plain load first, so that the many queries reaching a marked node only read the flag's cache line
+        return !_prioritized.load(std::memory_order_relaxed) && !_prioritized.exchange(true, std::memory_order_relaxed);
+    }
+
+    void SplitNode::evictColdChildren(const ArenaResource &arena, const size_t budget) {
+        for (size_t index = 0; index < _children.size() && arena.bytesInUse() > budget; ++index) {
+            auto *split = dynamic_cast<SplitNode *>(_children[index].load(std::memory_order_relaxed));
+            if (split == nullptr) {
+                continue;
+            }
+            //the child has been traversed since the last eviction -> keep it but look for cold subtrees below
+            if (split->_referenced.exchange(false, std::memory_order_relaxed)) {
+                split->evictColdChildren(arena, budget);
+                continue;
+            }
+            //the child is cold -> restore its face list and drop the subtree
+            TriangleIndexVector faces{_splitParam->arena.get()};
+            faces.reserve(_childFaceCounts[index]);
+            const FaceMarker::Lease processedFaces{FaceMarker::acquire()};
+            split->collectFaces(*processedFaces, faces);
+            //a canonical order, so that the rebuilt subtree does not depend on the shape of the evicted one
+            std::sort(faces.begin(), faces.end());
+            //the count is handed to the rebuilt subtree, so it has to describe the restored list
+            _childFaceCounts[index] = faces.size();
+            _childFaces[index] = std::move(faces);
+            _children[index].store(nullptr, std::memory_order_relaxed);
+            _ownedChildren[index].reset();
+            _childBuild[index].reset();
+        }
+    }
+
+    void SplitNode::collectFaces(FaceMarker &processedFaces, TriangleIndexVector &faces) {
+        const auto insertIfAbsent = [&processedFaces, &faces](const size_t faceIndex) {
+            if (processedFaces.insert(faceIndex)) {
+                faces.push_back(faceIndex);
+            }
+        };
+        for (size_t index = 0; index < _children.size(); ++index) {
+            TreeNode *node{_children[index].load(std::memory_order_relaxed)};
+            if (node == nullptr) {
+                std::visit(util::overloaded{
+                               [&insertIfAbsent](const TriangleIndexVector &indexList) {
+                                   std::for_each(indexList.cbegin(), indexList.cend(), insertIfAbsent);
+                               },
+                               [&insertIfAbsent](const PlaneEventVector &eventList) {
+                                   for (const PlaneEvent &event: eventList) {
+                                       insertIfAbsent(event.faceIndex);
+                                   }
+                               }
+                           }, _childFaces[index]);
+                continue;
+            }
+            if (auto *split = dynamic_cast<SplitNode *>(node)) {
+                split->collectFaces(processedFaces, faces);
+            } else if (auto *leaf = dynamic_cast<LeafNode *>(node)) {
+                const TriangleIndexVector &leafFaces{leaf->getBoundFaces()};
+                std::for_each(leafFaces.cbegin(), leafFaces.cend(), insertIfAbsent);
+            }
+        }
+    }
+
+    std::array<TreeNode *, 2> SplitNode::getChildrenForIntersection(
         const Array3 &origin, const Array3 &ray, const Array3 &inverseRay) {
         using namespace kdtree::util;
-        std::vector<std::shared_ptr<TreeNode> > delegates{};
+        //mark the node as recently used for the eviction, avoid writing the shared cache line if already marked
+        if (!_referenced.load(std::memory_order_relaxed)) {
+            _referenced.store(true, std::memory_order_relaxed);
+        }
         //a SplitNode has max two children, so no more space needed.
-        delegates.reserve(2);
-        //calculate entry and exit points of the ray hitting the bounding box
-        auto [t_enter, t_exit] = _boundingBox.rayBoxIntersection(origin, inverseRay);
+        std::array<TreeNode *, 2> delegates{nullptr, nullptr};
+        //calculate entry and exit points of the ray hitting the occupied part of the bounding box
+        auto [t_enter, t_exit] = _contentBox.rayBoxIntersection(origin, inverseRay);
         // bounding box was not hit because the ray passed the box or is moving into the opposite direction of it,
         if (t_exit < t_enter || t_exit < 0) {
             //empty
@@ -52,16 +129,15 @@ namespace kdtree {
         const bool isParallel = std::isinf(t_split);
         bool planeIsHitInsideBox = 0 <= t_split && t_enter <= t_split && t_split <= t_exit;
         if (!isParallel && planeIsHitInsideBox) {
-            delegates.push_back(getChildNode(0));
-            delegates.push_back(getChildNode(1));
+            delegates = {getChildNode(0), getChildNode(1)};
             return delegates;
         }
         // the split plane is behind the ray origin
         if (t_split < 0) {
             //check in which point the origin lies in order to continue intersection in that box
-            delegates.push_back(origin[static_cast<int>(_plane.orientation)] < _plane.axisCoordinate
-                                    ? getChildNode(0)
-                                    : getChildNode(1));
+            delegates[0] = origin[static_cast<int>(_plane.orientation)] < _plane.axisCoordinate
+                               ? getChildNode(0)
+                               : getChildNode(1);
             return delegates;
         }
         //intersection point of the ray and the bounding box
@@ -70,27 +146,33 @@ namespace kdtree {
         };
         // the entry point of the ray to the bounding box is nearer to the origin than the split plane -> ray hits lesser box
         if (intersectionCoord < _plane.axisCoordinate) {
-            delegates.push_back(getChildNode(0));
+            delegates[0] = getChildNode(0);
         }
         // only the greater box is hit by the ray
         else {
-            delegates.push_back(getChildNode(1));
+            delegates[0] = getChildNode(1);
         }
         return delegates;
     }
 
+    const Plane &SplitNode::getPlane() const {
+        return _plane;
+    }
+
     std::string SplitNode::toString() const {
         std::stringstream sstream{};
         sstream << "SplitNode ID:  " << this->nodeId << ", Depth: " << recursionDepth(this->nodeId) << ", Plane: " <<
                 this->_plane << std::endl;
-        sstream << "Children; Lesser: " << (this->_lesser != nullptr ? std::to_string(this->_lesser->nodeId) : "None")
-                << "; Greater: " << (this->_greater != nullptr ? std::to_string(this->_greater->nodeId) : "None") <<
+        const TreeNode *lesser{this->_children[0].load(std::memory_order_acquire)};
+        const TreeNode *greater{this->_children[1].load(std::memory_order_acquire)};
+        sstream << "Children; Lesser: " << (lesser != nullptr ? std::to_string(lesser->nodeId) : "None")
+                << "; Greater: " << (greater != nullptr ? std::to_string(greater->nodeId) : "None") <<
                 std::endl;
-        if (this->_lesser != nullptr) {
-            sstream << *(this->_lesser);
+        if (lesser != nullptr) {
+            sstream << *lesser;
         }
-        if (this->_greater != nullptr) {
-            sstream << *(this->_greater);
+        if (greater != nullptr) {
+            sstream << *greater;
         }
         return sstream.str();
     }
@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cmath>
 #include <cstddef>
 #include <iosfwd>
@@ -14,11 +15,15 @@
 #include <variant>
 #include <vector>
 
+#include "KDTree/tree/FaceMarker.h"
 #include "KDTree/tree/KdDefinitions.h"
+#include "KDTree/tree/LeafNode.h"
+#include "KDTree/tree/NodeArena.h"
 #include "KDTree/tree/SplitParam.h"
 #include "KDTree/tree/TreeNode.h"
 #include "KDTree/tree/TreeNodeFactory.h"
 #include "KDTree/util/UtilityContainer.h"
+#include "KDTree/util/UtilityParallel.h"
 
 namespace kdtree {
 struct SplitParam;
@@ -30,20 +35,30 @@ struct SplitParam;
         /**
          * friend declaration for testing purposes.
          */
-        friend class KDTreeTest_AlgorithmRegressionTest_Test;
+        friend class KDTreeRegressionTest_AlgorithmRegressionTest_Test;
 
         /**
-        * The SplitNode that contains the bounding box closer to the origin with respect to the split plane
-        */
-        std::shared_ptr<TreeNode> _lesser;
+         * Own the child nodes, index 0 for the node containing the bounding box closer to the origin with respect to the split plane (lesser) and 1 for the other one (greater).
+         * Only accessed while building or evicting a child, queries use {@link _children}.
+         */
+        std::array<std::shared_ptr<TreeNode>, 2> _ownedChildren;
         /**
-        * The SplitNode that contains the bounding box further away from the origin with respect to the split plane
-        */
-        std::shared_ptr<TreeNode> _greater;
+         * The built child nodes, nullptr while a child is not built. Published with release semantics once the child is complete, so that queries reach the children with a single acquire load
+         * and without touching reference counts.
+         */
+        std::array<std::atomic<TreeNode *>, 2> _children{nullptr, nullptr};
         /**
-         * Flags set when child node is created. Index 0 for lesser and 1 for greater.
+         * Serializes the creation of each child node, threads reaching a child under construction help building it. The children may be built concurrently. {@link util::CooperativeOnce}
          */
-        std::array<std::once_flag, 2> childNodeCreated;
+        std::array<util::CooperativeOnce, 2> _childBuild;
+        /**
+         * Reference bit of the clock eviction policy, set whenever a ray traverses this node and cleared by {@link evictColdChildren}.
+         */
+        std::atomic_bool _referenced{true};
+        /**
+         * Set once this node has been queued for prioritized building by a {@link BackgroundBuild}, so that the queries reaching it later don't queue it again.
+         */
+        std::atomic_bool _prioritized{false};
         /**
         * The plane splitting the two TreeNodes contained in this SplitNode
         */
@@ -53,37 +68,80 @@ struct SplitParam;
          */
         Box _boundingBox;
         /**
-         * Contains the triangle lists for the lesser and greater bounding boxes. {@link TriangleIndexVectors}
+         * The part of the bounding box occupied by the faces of this node. Rays missing it pass only empty space of the node. Equal to the bounding box unless {@link BuildOptions::tightBounds} is set.
+         */
+        Box _contentBox;
+        /**
+         * Contains the triangle lists for the lesser and greater bounding boxes. A list is moved into its child node once the child is built and collected again from the subtree when the child is evicted.
         */
-        std::variant<TriangleIndexVectors<2>, PlaneEventVectors<2>> _triangleLists;
+        std::array<std::variant<TriangleIndexVector, PlaneEventVector>, 2> _childFaces;
+        /**
+         * The amount of distinct faces in the lesser and greater triangle lists.
+         */
+        std::array<size_t, 2> _childFaceCounts;
 
     public:
         /**
-         * Takes parameters from the parent node and stores them for lazy child node creation.
-         * @param splitParam Parameters produced during the split that resulted in the creation of this node.
+         * Takes parameters from the parent node and stores them for lazy child node creation. The face list of the parameters is released, as the child nodes only need the triangle lists.
+         * @param splitParam Parameters produced during the split that resulted in the creation of this node, moved into the node.
          * @param plane The plane that splits this node's bounding box into two sub boxes. The child nodes are created based on these boxes.
          * @param triangleIndexLists Index sets of the triangles contained in the lesser and greater child nodes. {@link TriangleIndexVector}
+         * @param childFaceCounts The amount of distinct faces in the lesser and greater triangle lists.
+         * @param contentBox The part of the bounding box occupied by the faces, used to cull rays.
          * @param nodeId Unique Id given by the TreeNodeFactory.
          */
-        SplitNode(const SplitParam &splitParam, const Plane &plane, std::variant<TriangleIndexVectors<2>, PlaneEventVectors<2>> &triangleIndexLists, size_t nodeId);
+        SplitNode(SplitParam &&splitParam, const Plane &plane, std::variant<TriangleIndexVectors<2>, PlaneEventVectors<2>> &&triangleIndexLists, const std::array<size_t, 2> &childFaceCounts,
+                  const Box &contentBox, size_t nodeId);
         /**
          * Computes the child node decided by the given index (0 for lesser, 1 for greater) if not present already and returns it to the caller.
-         * @param index Specifies which node to build. 0 or LESSER for _lesser, 1 or GREATER for _greater.
-         * @return the built TreeNode.
+         * @param index Specifies which node to build. 0 or LESSER for the lesser child, 1 or GREATER for the greater child.
+         * @return the built TreeNode, owned by this node.
         */
-        std::shared_ptr<TreeNode> getChildNode(size_t index);
+        TreeNode *getChildNode(size_t index);
+        /**
+         * @param index Specifies the child. 0 or LESSER for the lesser child, 1 or GREATER for the greater child.
+         * @return true if the child has been built.
+         */
+        [[nodiscard]] bool isChildBuilt(size_t index) const;
+        /**
+         * Marks this node as queued for prioritized building. Checked before a query takes the lock of the {@link BackgroundBuild}.
+         * @return true if the node had not been marked before, i.e. the caller has to queue it.
+         */
+        bool markPrioritized();
         /**
          * Gets the children of this node whose bounding boxes are hit by the ray.
          * @param origin The point where the ray originates from.
          * @param ray Specifies the ray direction.
          * @param inverseRay The inverse of the ray (1/ray), used to speed up calculations where it is divided by ray. Instead, we multiply with inverseRay.
-         * @return the child nodes that intersect with the ray
+         * @return the child nodes that intersect with the ray, unused entries are nullptr. The nodes are owned by this node.
+         */
+        [[nodiscard]] std::array<TreeNode *, 2> getChildrenForIntersection(const Array3 &origin, const Array3 &ray, const Array3 &inverseRay);
+
+        /**
+         * @return the plane splitting this node's bounding box.
          */
-        [[nodiscard]] std::vector<std::shared_ptr<TreeNode>> getChildrenForIntersection(const Array3 &origin, const Array3 &ray, const Array3 &inverseRay);
+        [[nodiscard]] const Plane &getPlane() const;
+
+        /**
+         * Clock eviction: collapses the built child subtrees whose root has not been traversed since the last call back into their unbuilt state, so that they are rebuilt on demand.
+         * The reference bits of the remaining SplitNodes are cleared on the way down, giving them a second chance. Leaves are not collapsed, as they consist of little more than their face list.
+         * Must not be called concurrently with any other access to the subtree. Pointers to the evicted nodes become invalid.
+         * @param arena The arena of the tree, used to check the memory budget.
+         * @param budget Stops evicting once the arena uses at most this amount of bytes.
+         */
+        void evictColdChildren(const ArenaResource &arena, size_t budget);
 
         [[nodiscard]] std::string toString() const override;
 
         friend std::ostream &operator<<(std::ostream &os, const SplitNode &node);
+
+    private:
+        /**
+         * Collects the distinct faces contained in the subtree of this node from its leaves and unbuilt children.
+         * @param processedFaces Marks the faces already collected.
+         * @param faces The list the faces are appended to.
+         */
+        void collectFaces(FaceMarker &processedFaces, TriangleIndexVector &faces);
     };
 
 }// namespace kdtree
\ No newline at end of file
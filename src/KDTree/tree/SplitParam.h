@@ -1,6 +1,8 @@
 #pragma once
 
+#include "KDTree/tree/BuildOptions.h"
 #include "KDTree/tree/KdDefinitions.h"
+#include "KDTree/tree/NodeArena.h"
 
 namespace kdtree {
     //forward declaration
@@ -22,6 +24,10 @@ namespace kdtree {
          * Either an index list of faces that are included in the current bounding box of the KDTree or a list of PlaneEvents containing the information about thr bound faces. Important when building deeper levels of a KDTree.
          */
         std::variant<TriangleIndexVector, PlaneEventVector> boundFaces;
+        /**
+         * The amount of distinct faces in boundFaces. It is counted once when the parent node is split and carried forward, as counting the faces of PlaneEvents requires deduplication.
+         */
+        size_t faceCount;
         /**
          * The current bounding box that should be divided further by the KDTree.
          */
@@ -35,6 +41,14 @@ namespace kdtree {
          * The algorithm used to create new child TreeNodes after splitting the parent.
          */
         const std::shared_ptr<PlaneSelectionAlgorithm> planeSelectionStrategy;
+        /**
+         * The arena of the tree, which the nodes and their face lists are allocated from. {@link NodeArena}
+         */
+        NodeArena arena;
+        /**
+         * The cost constants and termination criteria of the tree building. {@link BuildOptions}
+         */
+        const BuildOptions &options;
 
         /**
          * Constructor that initializes all fields. Intended for the use with std::make_unique. See {@link SplitParam} fields for further information.
@@ -42,9 +56,13 @@ namespace kdtree {
          */
         SplitParam(const std::vector<Array3> &vertices, const std::vector<IndexArray3> &faces, const Box &boundingBox,
                    const Direction splitDirection,
-                   const std::shared_ptr<PlaneSelectionAlgorithm> &planeSelectionStrategy)
-            : vertices{vertices}, faces{faces}, boundFaces{TriangleIndexVector(faces.size())}, boundingBox{boundingBox},
-              splitDirection{splitDirection}, planeSelectionStrategy{planeSelectionStrategy} {
+                   const std::shared_ptr<PlaneSelectionAlgorithm> &planeSelectionStrategy,
+                   const NodeArena &arena = createNodeArena(), const BuildOptions &options = DEFAULT_BUILD_OPTIONS)
+            : vertices{vertices}, faces{faces}, boundFaces{TriangleIndexVector(faces.size(), arena.get())},
+              faceCount{faces.size()},
+              boundingBox{boundingBox},
+              splitDirection{splitDirection}, planeSelectionStrategy{planeSelectionStrategy}, arena{arena},
+              options{options} {
             auto &indexList = std::get<TriangleIndexVector>(boundFaces);
             std::iota(indexList.begin(), indexList.end(), 0);
         }
@@ -55,9 +73,53 @@ namespace kdtree {
         SplitParam(const std::vector<Array3> &vertices, const std::vector<IndexArray3> &faces,
                    const std::variant<TriangleIndexVector, PlaneEventVector> &boundFaces, const Box &boundingBox,
                    const Direction splitDirection,
-                   const std::shared_ptr<PlaneSelectionAlgorithm> &planeSelectionStrategy)
-            : vertices{vertices}, faces{faces}, boundFaces{boundFaces}, boundingBox{boundingBox},
-              splitDirection{splitDirection}, planeSelectionStrategy{planeSelectionStrategy} {
+                   const std::shared_ptr<PlaneSelectionAlgorithm> &planeSelectionStrategy,
+                   const NodeArena &arena = createNodeArena(), const BuildOptions &options = DEFAULT_BUILD_OPTIONS)
+            : vertices{vertices}, faces{faces}, boundFaces{copyToArena(boundFaces, arena)},
+              faceCount{countFaces(boundFaces)},
+              boundingBox{boundingBox},
+              splitDirection{splitDirection}, planeSelectionStrategy{planeSelectionStrategy}, arena{arena},
+              options{options} {
+        }
+
+        /**
+         * Constructor for the parameters of a child node. The child takes over the given face list, the remaining parameters are shared with the parent.
+         * @param parent The parameters of the parent node.
+         * @param boundFaces The faces contained in the child's bounding box.
+         * @param faceCount The amount of distinct faces in boundFaces.
+         * @param boundingBox The bounding box of the child.
+         * @param splitDirection The direction in which the child's bounding box should be divided.
+         */
+        SplitParam(const SplitParam &parent, std::variant<TriangleIndexVector, PlaneEventVector> &&boundFaces,
+                   const size_t faceCount, const Box &boundingBox, const Direction splitDirection)
+            : vertices{parent.vertices}, faces{parent.faces}, boundFaces{std::move(boundFaces)}, faceCount{faceCount},
+              boundingBox{boundingBox}, splitDirection{splitDirection},
+              planeSelectionStrategy{parent.planeSelectionStrategy}, arena{parent.arena}, options{parent.options} {
+        }
+
+        /**
+         * Copies the parameters, the copied face list is allocated from the same arena. Explicit, as the face lists are large and the tree building passes the parameters on by moving them.
+         */
+        explicit SplitParam(const SplitParam &other)
+            : vertices{other.vertices}, faces{other.faces}, boundFaces{copyToArena(other.boundFaces, other.arena)},
+              faceCount{other.faceCount}, boundingBox{other.boundingBox}, splitDirection{other.splitDirection},
+              planeSelectionStrategy{other.planeSelectionStrategy}, arena{other.arena}, options{other.options} {
+        }
+
+        SplitParam(SplitParam &&other) = default;
+
+    private:
+        /**
+         * Copies a face list into an arena. The copy constructors of the lists would allocate from the default memory resource instead.
+         * @param boundFaces The face list to copy.
+         * @param arena The arena to allocate the copy from.
+         * @return the copied face list.
+         */
+        static std::variant<TriangleIndexVector, PlaneEventVector> copyToArena(
+            const std::variant<TriangleIndexVector, PlaneEventVector> &boundFaces, const NodeArena &arena) {
+            return std::visit([&arena](const auto &faceList) -> std::variant<TriangleIndexVector, PlaneEventVector> {
+                return std::decay_t<decltype(faceList)>(faceList, arena.get());
+            }, boundFaces);
         }
     };
 } // namespace kdtree
@@ -1,8 +1,8 @@
 #include "KDTree/tree/TreeNode.h"
 
 namespace kdtree {
-    TreeNode::TreeNode(const SplitParam &splitParam, const size_t nodeId)
-        : nodeId{nodeId}, _splitParam{std::make_unique<SplitParam>(splitParam)} {
+    TreeNode::TreeNode(SplitParam &&splitParam, const size_t nodeId)
+        : nodeId{nodeId}, _splitParam{std::move(splitParam)} {
     }
 
     std::ostream& operator<<(std::ostream& os, const TreeNode& node) {
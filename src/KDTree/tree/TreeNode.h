@@ -2,6 +2,7 @@
 
 #include <cstddef>
 #include <memory>
+#include <optional>
 
 #include "KDTree/tree/KdDefinitions.h"
 #include "KDTree/tree/SplitParam.h"
@@ -29,11 +30,12 @@ namespace kdtree {
         /**
         * Protected constructor intended only for child classes. Please use {@link TreeNodeFactory} instead.
         */
-        explicit TreeNode(const SplitParam &splitParam, size_t nodeId);
+        explicit TreeNode(SplitParam &&splitParam, size_t nodeId);
         /**
         * Stores parameters required for building child nodes lazily. Gets freed if the Node is an inner node and after both children are built.
+        * Stored inline, so that it shares the node's allocation from the {@link NodeArena}.
         */
-        std::unique_ptr<SplitParam> _splitParam;
+        std::optional<SplitParam> _splitParam;
     };
 
 }// namespace kdtree
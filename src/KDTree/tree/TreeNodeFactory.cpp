@@ -1,32 +1,143 @@
 #include "KDTree/tree/TreeNodeFactory.h"
 
     namespace kdtree::TreeNodeFactory {
-        std::unique_ptr<TreeNode> createTreeNode(const SplitParam &splitParam, size_t nodeId) {
-            //avoid splitting after certain tree depth
-            if (recursionDepth(nodeId) >= MAX_RECURSION_DEPTH) {
-                return std::make_unique<LeafNode>(splitParam, nodeId);
+        namespace {
+            /**
+             * Finds the largest empty space between the faces and a side of the bounding box.
+             * @param boundingBox The bounding box of the node.
+             * @param contentBox The part of the bounding box occupied by the faces.
+             * @param threshold The minimal fraction of the box's extent the empty space has to span.
+             * @return the plane cutting the empty space off and the index of the empty child (0 for lesser, 1 for greater) or std::nullopt if no empty space spans the threshold.
+             */
+            std::optional<std::pair<Plane, size_t> > findEmptyCutoff(const Box &boundingBox, const Box &contentBox,
+                                                                     const double threshold) {
+                std::optional<std::pair<Plane, size_t> > cutoff{};
+                double largestGap{threshold};
+                for (const auto direction: ALL_DIRECTIONS) {
+                    const auto axis{static_cast<size_t>(direction)};
+                    const double extent{boundingBox.maxPoint[axis] - boundingBox.minPoint[axis]};
+                    if (extent <= 0.0) {
+                        continue;
+                    }
+                    const double lesserGap{(contentBox.minPoint[axis] - boundingBox.minPoint[axis]) / extent};
+                    const double greaterGap{(boundingBox.maxPoint[axis] - contentBox.maxPoint[axis]) / extent};
+                    //a plane on the border of the box would create a child identical to this node
+                    if (lesserGap >= largestGap && lesserGap > 0.0) {
+                        largestGap = lesserGap;
+                        cutoff.emplace(Plane{contentBox.minPoint[axis], direction}, 0);
+                    }
+                    if (greaterGap >= largestGap && greaterGap > 0.0) {
+                        largestGap = greaterGap;
+                        cutoff.emplace(Plane{contentBox.maxPoint[axis], direction}, 1);
+                    }
+                }
+                return cutoff;
+            }
+        } // namespace
+
+        std::shared_ptr<TreeNode> createTreeNode(SplitParam &&splitParam, size_t nodeId) {
+            const BuildOptions &options{splitParam.options};
+            //avoid splitting after certain tree depth or below the minimal leaf size
+            if (recursionDepth(nodeId) >= options.maxDepth || splitParam.faceCount <= options.minLeafSize) {
+                return std::allocate_shared<LeafNode>(ArenaAllocator<LeafNode>{splitParam.arena}, std::move(splitParam), nodeId);
+            }
+            const size_t numberOfFaces{splitParam.faceCount};
+            const Box contentBox{
+                options.tightBounds || options.emptyCutoffThreshold > 0.0 ? contentBounds(splitParam) : splitParam.boundingBox
+            };
+            //rays are culled against the box the split node keeps
+            const Box cullingBox{options.tightBounds ? contentBox : splitParam.boundingBox};
+            //large empty space is cut off by a split, whose empty child is a leaf without faces
+            if (options.emptyCutoffThreshold > 0.0) {
+                if (const auto cutoff = findEmptyCutoff(splitParam.boundingBox, contentBox, options.emptyCutoffThreshold)) {
+                    const auto &[plane, emptyIndex] = *cutoff;
+                    std::array<size_t, 2> childFaceCounts{numberOfFaces, numberOfFaces};
+                    childFaceCounts[emptyIndex] = 0;
+                    //all faces lie inside the box of the other child -> they are handed on unchanged
+                    auto triangleLists = std::visit([&splitParam, emptyIndex = emptyIndex](auto &faceList)
+                        -> std::variant<TriangleIndexVectors<2>, PlaneEventVectors<2> > {
+                            using FaceList = std::decay_t<decltype(faceList)>;
+                            std::array<std::unique_ptr<FaceList>, 2> lists{};
+                            lists[emptyIndex] = std::make_unique<FaceList>(splitParam.arena.get());
+                            lists[1 - emptyIndex] = std::make_unique<FaceList>(std::move(faceList));
+                            return lists;
+                        }, splitParam.boundFaces);
+                    return std::allocate_shared<SplitNode>(ArenaAllocator<SplitNode>{splitParam.arena}, std::move(splitParam), plane, std::move(triangleLists), childFaceCounts,
+                                                           cullingBox, nodeId);
+                }
             }
-            const size_t numberOfFaces{countFaces(splitParam.boundFaces)};
             //find optimal plane splitting this node's bounding box
             auto [plane, planeCost, triangleLists] = splitParam.planeSelectionStrategy->findPlane(splitParam);
-            const double costWithoutSplit = static_cast<double>(numberOfFaces) * PlaneSelectionAlgorithm::triangleIntersectionCost;
-
-            // Check if the boxes are divided into smaller regions
-            const bool splitFailsToReduceSize = std::isinf(planeCost) || std::visit([numberOfFaces](auto &typeLists) {
-                                              // Count faces in each split box
-                                              const size_t facesInMinimalBox = countFaces(*typeLists[0]);
-                                              const size_t facesInMaximalBox = countFaces(*typeLists[1]);
+            const double costWithoutSplit = static_cast<double>(numberOfFaces) * options.triangleIntersectionCost;
 
-                                              // Ensure that the split meaningfully divides faces
-                                              return numberOfFaces <= facesInMinimalBox + facesInMaximalBox && (facesInMinimalBox == 0 || facesInMaximalBox == 0);
-                                          },
-                                                                              triangleLists);
+            if (std::isinf(planeCost) || planeCost > costWithoutSplit) {
+                return std::allocate_shared<LeafNode>(ArenaAllocator<LeafNode>{splitParam.arena}, std::move(splitParam), nodeId);
+            }
+            // Count faces in each split box, the counts are handed to the child nodes
+            const std::array<size_t, 2> childFaceCounts = std::visit([](auto &typeLists) {
+                return std::array<size_t, 2>{countFaces(*typeLists[0]), countFaces(*typeLists[1])};
+            }, triangleLists);
+            const auto [facesInMinimalBox, facesInMaximalBox] = childFaceCounts;
+            // Ensure that the split meaningfully divides faces
+            const bool splitFailsToReduceSize = numberOfFaces <= facesInMinimalBox + facesInMaximalBox && (facesInMinimalBox == 0 || facesInMaximalBox == 0);
             //if the cost of splitting this node further is greater than just traversing the bound triangles or splitting does not reduce the amount of work in the resulting sub boxes, then don't split and return a LeafNode
-            if (planeCost > costWithoutSplit || splitFailsToReduceSize) {
-                return std::make_unique<LeafNode>(splitParam, nodeId);
+            if (splitFailsToReduceSize) {
+                return std::allocate_shared<LeafNode>(ArenaAllocator<LeafNode>{splitParam.arena}, std::move(splitParam), nodeId);
             }
             //if not more costly, perform the split
-            return std::make_unique<SplitNode>(splitParam, plane, triangleLists, nodeId);
+            return std::allocate_shared<SplitNode>(ArenaAllocator<SplitNode>{splitParam.arena}, std::move(splitParam), plane, std::move(triangleLists), childFaceCounts,
+                                                   cullingBox, nodeId);
+        }
+
+        Box contentBounds(const SplitParam &splitParam) {
+            const Box &boundingBox{splitParam.boundingBox};
+            constexpr double infinity{std::numeric_limits<double>::infinity()};
+            Box bounds{std::make_pair(Array3{infinity, infinity, infinity}, Array3{-infinity, -infinity, -infinity})};
+            std::visit(util::overloaded{
+                           [&splitParam, &boundingBox, &bounds](const TriangleIndexVector &faceIndices) {
+                               for (const size_t faceIndex: faceIndices) {
+                                   for (const size_t vertexIndex: splitParam.faces[faceIndex]) {
+                                       const Array3 &vertex{splitParam.vertices[vertexIndex]};
+                                       for (size_t axis = 0; axis < DIMENSIONS; ++axis) {
+                                           //the part of the face outside the node's box has been clipped off by the parent
+                                           const double coordinate{
+                                               std::clamp(vertex[axis], boundingBox.minPoint[axis], boundingBox.maxPoint[axis])
+                                           };
+                                           bounds.minPoint[axis] = std::min(bounds.minPoint[axis], coordinate);
+                                           bounds.maxPoint[axis] = std::max(bounds.maxPoint[axis], coordinate);
+                                       }
+                                   }
+                               }
+                           },
+                           [&splitParam, &boundingBox, &bounds](const PlaneEventVector &events) {
+                               //a face lying in a plane only has events on its first planar axis, its extent on the other axes is missing -> clip each face of the events once
+                               std::vector<size_t> faceIndices(events.size());
+                               std::transform(events.cbegin(), events.cend(), faceIndices.begin(),
+                                              [](const PlaneEvent &event) { return static_cast<size_t>(event.faceIndex); });
+                               std::sort(faceIndices.begin(), faceIndices.end());
+                               faceIndices.erase(std::unique(faceIndices.begin(), faceIndices.end()), faceIndices.end());
+                               for (const size_t faceIndex: faceIndices) {
+                                   const IndexArray3 &face{splitParam.faces[faceIndex]};
+                                   const std::optional<Box> clipped{boundingBox.clipToVoxelBounds(
+                                       {splitParam.vertices[face[0]], splitParam.vertices[face[1]], splitParam.vertices[face[2]]})};
+                                   if (!clipped.has_value()) {
+                                       continue;
+                                   }
+                                   for (size_t axis = 0; axis < DIMENSIONS; ++axis) {
+                                       bounds.minPoint[axis] = std::min(bounds.minPoint[axis], clipped->minPoint[axis]);
+                                       bounds.maxPoint[axis] = std::max(bounds.maxPoint[axis], clipped->maxPoint[axis]);
+                                   }
+                               }
+                           }
+                       }, splitParam.boundFaces);
+            //an axis without faces or events keeps the extent of the box
+            for (size_t axis = 0; axis < DIMENSIONS; ++axis) {
+                if (bounds.minPoint[axis] > bounds.maxPoint[axis]) {
+                    bounds.minPoint[axis] = boundingBox.minPoint[axis];
+                    bounds.maxPoint[axis] = boundingBox.maxPoint[axis];
+                }
+            }
+            return bounds;
         }
     } // namespace kdtree::TreeNodeFactory
 
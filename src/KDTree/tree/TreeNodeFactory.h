@@ -1,11 +1,15 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <variant>
+#include <vector>
 
+#include "KDTree/tree/BuildOptions.h"
 #include "KDTree/tree/KdDefinitions.h"
 #include "KDTree/tree/LeafNode.h"
 #include "KDTree/tree/SplitNode.h"
@@ -17,19 +21,24 @@ namespace kdtree {
 struct SplitParam;
 }  // namespace kdtree
 
-constexpr uint8_t MAX_RECURSION_DEPTH{64};
-
     /**
      * Factory class for building TreeNodes. {@link TreeNode}
      */
     namespace kdtree::TreeNodeFactory {
         /**
         * Builds a new TreeNode for a KDTree. {@link KDTree}
-        * @param splitParam Parameters for intersection testing and child node creation. {@link SplitParam}
+        * @param splitParam Parameters for intersection testing and child node creation, moved into the new node. {@link SplitParam}
         * @param nodeId The unique id to be assigned to the newly created node. Follows the convention that the left child gets the id 2 * <current_id> + 1 and
         * the right child 2 * <currrent_id> + 2.
-        * @return A unique pointer to the new TreeNode.
+        * @return A shared pointer to the new TreeNode. The node and its control block are allocated from the arena of the split parameters. {@link NodeArena}
+         */
+        std::shared_ptr<TreeNode> createTreeNode(SplitParam &&splitParam, size_t nodeId);
+
+        /**
+         * Calculates the part of a node's bounding box that is occupied by its faces. Faces given by index are bounded by their vertices, so the result may be larger than the exact bounds of the clipped faces.
+         * @param splitParam The parameters of the node. {@link SplitParam}
+         * @return the bounds of the faces clipped to the node's bounding box.
          */
-        std::unique_ptr<TreeNode> createTreeNode(const SplitParam &splitParam, size_t nodeId);
+        Box contentBounds(const SplitParam &splitParam);
     } // namespace kdtree::TreeNodeFactory
 
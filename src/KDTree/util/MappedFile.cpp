@@ -0,0 +1,109 @@
+#include "KDTree/util/MappedFile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace kdtree::util {
+
+#ifndef _WIN32
+    MappedFile::MappedFile(const std::string &path) {
+        const int descriptor{::open(path.c_str(), O_RDONLY)};
+        if (descriptor < 0) {
+            throw std::runtime_error("The file " + path + " cannot be opened.");
+        }
+        struct stat status{};
+        if (::fstat(descriptor, &status) != 0) {
+            ::close(descriptor);
+            throw std::runtime_error("The size of the file " + path + " cannot be determined.");
+        }
+        _size = static_cast<size_t>(status.st_size);
+        //an empty file cannot be mapped
+        if (_size != 0) {
+            void *mapping{::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, descriptor, 0)};
+            if (mapping == MAP_FAILED) {
+                ::close(descriptor);
+                throw std::runtime_error("The file " + path + " cannot be mapped into memory.");
+            }
+            _data = static_cast<const std::byte *>(mapping);
+            _mapped = true;
+        }
+        //the mapping stays valid after closing the file
+        ::close(descriptor);
+    }
+#else
+    MappedFile::MappedFile(const std::string &path) {
+        std::ifstream file{path, std::ios::binary};
+        if (!file) {
+            throw std::runtime_error("The file " + path + " cannot be opened.");
+        }
+        *this = fromStream(file);
+    }
+#endif
+
+    MappedFile MappedFile::fromStream(std::istream &stream) {
+        const std::string content{std::istreambuf_iterator<char>{stream}, std::istreambuf_iterator<char>{}};
+        if (stream.bad()) {
+            throw std::runtime_error("The stream cannot be read.");
+        }
+        MappedFile file{};
+        file._size = content.size();
+        if (file._size != 0) {
+            //operator new[] aligns to at least 16 bytes
+            file._buffer = std::make_unique<std::byte[]>(file._size);
+            std::copy(content.cbegin(), content.cend(), reinterpret_cast<char *>(file._buffer.get()));
+            file._data = file._buffer.get();
+        }
+        return file;
+    }
+
+    MappedFile::MappedFile(MappedFile &&other) noexcept
+        : _data{std::exchange(other._data, nullptr)}, _size{std::exchange(other._size, 0)},
+          _mapped{std::exchange(other._mapped, false)}, _buffer{std::move(other._buffer)} {
+    }
+
+    MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+        if (this != &other) {
+            release();
+            _data = std::exchange(other._data, nullptr);
+            _size = std::exchange(other._size, 0);
+            _mapped = std::exchange(other._mapped, false);
+            _buffer = std::move(other._buffer);
+        }
+        return *this;
+    }
+
+    MappedFile::~MappedFile() {
+        release();
+    }
+
+    const std::byte *MappedFile::data() const {
+        return _data;
+    }
+
+    size_t MappedFile::size() const {
+        return _size;
+    }
+
+    void MappedFile::release() noexcept {
+#ifndef _WIN32
+        if (_mapped) {
+            ::munmap(const_cast<std::byte *>(_data), _size);
+        }
+#endif
+        _buffer.reset();
+        _data = nullptr;
+        _size = 0;
+        _mapped = false;
+    }
+
+}// namespace kdtree::util
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <string>
+
+namespace kdtree::util {
+
+    /**
+     * A read only view of a file's content, which is memory mapped where the platform supports it, so that the content is paged in on demand and shared between processes.
+     * Alternatively holds a copy of the content of a stream. The content is aligned to at least 16 bytes.
+     */
+    class MappedFile {
+        /**
+         * The first byte of the content, nullptr if empty.
+         */
+        const std::byte *_data{nullptr};
+
+        /**
+         * The size of the content in bytes.
+         */
+        size_t _size{0};
+
+        /**
+         * True if _data points to a memory mapping, which has to be unmapped.
+         */
+        bool _mapped{false};
+
+        /**
+         * The copied content if the content has not been mapped.
+         */
+        std::unique_ptr<std::byte[]> _buffer;
+
+        MappedFile() = default;
+
+    public:
+        /**
+         * Maps the file into memory.
+         * @param path The path of the file.
+         * @throws std::runtime_error if the file cannot be opened or mapped.
+         */
+        explicit MappedFile(const std::string &path);
+
+        /**
+         * Copies the remaining content of a stream.
+         * @param stream The stream to read.
+         * @return the copied content.
+         * @throws std::runtime_error if reading the stream fails.
+         */
+        static MappedFile fromStream(std::istream &stream);
+
+        MappedFile(MappedFile &&other) noexcept;
+
+        MappedFile &operator=(MappedFile &&other) noexcept;
+
+        MappedFile(const MappedFile &) = delete;
+
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        ~MappedFile();
+
+        /**
+         * @return the first byte of the content, nullptr if the content is empty.
+         */
+        [[nodiscard]] const std::byte *data() const;
+
+        /**
+         * @return the size of the content in bytes.
+         */
+        [[nodiscard]] size_t size() const;
+
+    private:
+        /**
+         * Releases the mapping or the buffer.
+         */
+        void release() noexcept;
+    };
+
+}// namespace kdtree::util
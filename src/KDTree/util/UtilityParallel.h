@@ -0,0 +1,134 @@
+#pragma once
+
+#include <exception>
+#include <mutex>
+#include <optional>
+
+#ifdef KD_TREE_TBB
+#include <tbb/collaborative_call_once.h>
+#include <tbb/parallel_invoke.h>
+#endif
+
+namespace kdtree::util {
+
+    /**
+     * Runs a function as the root of a task graph, whose tasks are spawned by {@link parallelInvoke}. OpenMP requires this to create the team of threads executing the tasks,
+     * the other backends simply call the function.
+     * @tparam Function callable without arguments
+     * @param function the root task
+     */
+    template<typename Function>
+    void parallelRegion(const Function &function) {
+#ifdef KD_TREE_OMP
+        std::exception_ptr exception{};
+#pragma omp parallel default(shared)
+#pragma omp single
+        {
+            //exceptions must not leave an OpenMP structured block -> rethrow them afterward
+            try {
+                function();
+            } catch (...) {
+                exception = std::current_exception();
+            }
+        }
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+#else
+        function();
+#endif
+    }
+
+    /**
+     * Executes two independent functions as tasks, which are taken over by idle threads through the work stealing scheduler of the parallelization backend (TBB or OpenMP).
+     * The sequential backend executes them one after another.
+     * @tparam First callable without arguments
+     * @tparam Second callable without arguments
+     * @param first the first task
+     * @param second the second task
+     */
+    template<typename First, typename Second>
+    void parallelInvoke(const First &first, const Second &second) {
+#if defined(KD_TREE_TBB)
+        tbb::parallel_invoke(first, second);
+#elif defined(KD_TREE_OMP)
+        std::exception_ptr exception{};
+        std::mutex exceptionLock{};
+        const auto guarded = [&exception, &exceptionLock](const auto &task) {
+            //exceptions must not leave an OpenMP task -> keep the first one and rethrow it after both tasks finished
+            try {
+                task();
+            } catch (...) {
+                std::lock_guard lock{exceptionLock};
+                if (!exception) {
+                    exception = std::current_exception();
+                }
+            }
+        };
+#pragma omp task default(shared)
+        guarded(first);
+        guarded(second);
+#pragma omp taskwait
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+#else
+        first();
+        second();
+#endif
+    }
+
+    /**
+     * Guards a one-time initialization, which may be reset to run again. Threads arriving while the initialization runs wait for it to complete.
+     * With TBB the waiting threads join the initializing thread and execute the tasks it spawns (tbb::collaborative_call_once), so that they help instead of idling.
+     * The other backends block the waiting threads on a mutex.
+     */
+    class CooperativeOnce {
+#ifdef KD_TREE_TBB
+        /**
+         * The flag of the current round, replaced by {@link reset}, since TBB's flags cannot be reset.
+         */
+        std::optional<tbb::collaborative_once_flag> _flag{std::in_place};
+#else
+        /**
+         * Serializes the initialization.
+         */
+        std::mutex _mutex;
+        /**
+         * Set when the initialization completed successfully. Only accessed while holding the mutex.
+         */
+        bool _done{false};
+#endif
+
+    public:
+        /**
+         * Runs the function unless it already completed successfully since the last reset. If the function throws, the exception is propagated and a later call runs it again.
+         * @tparam Function callable without arguments
+         * @param function the initialization
+         */
+        template<typename Function>
+        void callOnce(const Function &function) {
+#ifdef KD_TREE_TBB
+            tbb::collaborative_call_once(*_flag, function);
+#else
+            std::lock_guard lock{_mutex};
+            if (!_done) {
+                function();
+                _done = true;
+            }
+#endif
+        }
+
+        /**
+         * Allows the initialization to run again. Must not be called concurrently with {@link callOnce}.
+         */
+        void reset() {
+#ifdef KD_TREE_TBB
+            _flag.emplace();
+#else
+            _done = false;
+#endif
+        }
+    };
+
+}
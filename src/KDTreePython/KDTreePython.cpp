@@ -1,9 +1,18 @@
 #include <nanobind/nanobind.h>
 #include <nanobind/stl/string.h>
 #include <nanobind/stl/array.h>
+#include <nanobind/stl/optional.h>
 #include <nanobind/stl/set.h>
+#include <nanobind/stl/tuple.h>
+#include <nanobind/stl/unique_ptr.h>
 #include <nanobind/stl/vector.h>
 
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <tuple>
+
+#include "KDTree/input/TetgenAdapter.h"
 #include "KDTree/tree/KDTree.h"
 
 namespace nb = nanobind;
@@ -18,21 +27,62 @@ void printTree(const kdtree::KDTree& tree) {
 NB_MODULE(KDTree_Python, m) {
     using namespace kdtree;
     nb::enum_<PlaneSelectionAlgorithm::Algorithm>(m, "PlaneSelectionAlgorithm")
+    .value("BINNED", PlaneSelectionAlgorithm::Algorithm::BINNED)
     .value("LOG", PlaneSelectionAlgorithm::Algorithm::LOG)
     .value("LOGSQUARED", PlaneSelectionAlgorithm::Algorithm::LOGSQUARED)
     .value("QUADRATIC", PlaneSelectionAlgorithm::Algorithm::QUADRATIC)
     .value("NOTREE", PlaneSelectionAlgorithm::Algorithm::NOTREE);
+    nb::class_<BuildOptions>(m, "BuildOptions")
+    .def(nb::init<>())
+    .def_rw("traverseStepCost", &BuildOptions::traverseStepCost)
+    .def_rw("triangleIntersectionCost", &BuildOptions::triangleIntersectionCost)
+    .def_rw("maxDepth", &BuildOptions::maxDepth)
+    .def_rw("minLeafSize", &BuildOptions::minLeafSize)
+    .def_rw("emptySpaceBonus", &BuildOptions::emptySpaceBonus)
+    .def_rw("scaleEmptySpaceBonus", &BuildOptions::scaleEmptySpaceBonus)
+    .def_rw("emptyCutoffThreshold", &BuildOptions::emptyCutoffThreshold)
+    .def_rw("tightBounds", &BuildOptions::tightBounds)
+    .def("validate", &BuildOptions::validate)
+    .def_static("autoTune", &BuildOptions::autoTune, "vertices"_a, "faces"_a, nb::call_guard<nb::gil_scoped_release>());
     nb::class_<KDTree>(m, "KDTree")
-    .def(nb::init<const std::vector<Array3>&, const std::vector<IndexArray3>&, const PlaneSelectionAlgorithm::Algorithm>(), "vertices"_a, "faces"_a, "algorithm"_a = PlaneSelectionAlgorithm::Algorithm::LOG)
-    .def(nb::init<const std::tuple<std::vector<Array3>, std::vector<IndexArray3>> &, const PlaneSelectionAlgorithm::Algorithm>(), "polySource"_a, "algorithm"_a = PlaneSelectionAlgorithm::Algorithm::LOG)
-    .def(nb::init<const std::string&, const std::string&, const PlaneSelectionAlgorithm::Algorithm>(), "nodeFilePath"_a, "faceFilePath"_a, "algorithm"_a = PlaneSelectionAlgorithm::Algorithm::LOG)
-    .def("countIntersections", &KDTree::countIntersections,"origin"_a, "ray"_a)
+    .def(nb::init<std::vector<Array3>, std::vector<IndexArray3>, const PlaneSelectionAlgorithm::Algorithm, const BuildOptions &>(), "vertices"_a, "faces"_a, "algorithm"_a = PlaneSelectionAlgorithm::Algorithm::LOG, "options"_a = BuildOptions{})
+    .def(nb::init<std::tuple<std::vector<Array3>, std::vector<IndexArray3>>, const PlaneSelectionAlgorithm::Algorithm, const BuildOptions &>(), "polySource"_a, "algorithm"_a = PlaneSelectionAlgorithm::Algorithm::LOG, "options"_a = BuildOptions{})
+    .def(nb::init<const std::string&, const std::string&, const PlaneSelectionAlgorithm::Algorithm, const BuildOptions &>(), "nodeFilePath"_a, "faceFilePath"_a, "algorithm"_a = PlaneSelectionAlgorithm::Algorithm::LOG, "options"_a = BuildOptions{})
+    .def("countIntersections", nb::overload_cast<const Array3 &, const Array3 &>(&KDTree::countIntersections), "origin"_a, "ray"_a)
+    .def("countIntersections", nb::overload_cast<const std::vector<Array3> &, const std::vector<Array3> &>(&KDTree::countIntersections),
+         "origins"_a, "rays"_a, nb::call_guard<nb::gil_scoped_release>())
+    .def("countCrossings", &KDTree::countCrossings, "origin"_a, "ray"_a)
+    .def("isInside", &KDTree::isInside, "point"_a)
     .def("getFaceIntersections", [](KDTree& self, const Array3 &origin, const Array3 &ray) {
         std::set<Array3> intersections{};
         self.getFaceIntersections(origin, ray, intersections);
         return std::vector<Array3>(intersections.begin(), intersections.end());
     }, "origin"_a, "ray"_a)
+    .def("closestIntersection", &KDTree::closestIntersection, "origin"_a, "ray"_a)
+    .def("anyIntersection", &KDTree::anyIntersection, "origin"_a, "ray"_a, "tMax"_a = std::numeric_limits<double>::infinity())
     .def("prebuildTree", &KDTree::prebuildTree, nb::rv_policy::reference_internal)
+    .def("setMemoryBudget", &KDTree::setMemoryBudget, "bytes"_a)
+    .def("memoryUsage", &KDTree::memoryUsage)
+    .def("buildInBackground", [](KDTree &self, const size_t threadCount) -> KDTree & {
+        return self.buildInBackground(threadCount);
+    }, "threadCount"_a = 0, nb::rv_policy::reference_internal)
+    .def("cancelBackgroundBuild", &KDTree::cancelBackgroundBuild)
+    .def("waitForBackgroundBuild", &KDTree::waitForBackgroundBuild, nb::call_guard<nb::gil_scoped_release>())
+    .def("save", nb::overload_cast<const std::string &>(&KDTree::save), "path"_a, nb::call_guard<nb::gil_scoped_release>())
+    .def_static("load", [](const std::string &path, const std::vector<Array3> &vertices, const std::vector<IndexArray3> &faces) {
+        return std::unique_ptr<KDTree>(new KDTree(KDTree::load(path, vertices, faces)));
+    }, "path"_a, "vertices"_a, "faces"_a)
+    .def("__getstate__", [](KDTree &self) {
+        std::ostringstream stream{std::ios::binary};
+        self.save(stream);
+        const std::string image{stream.str()};
+        return std::make_tuple(self.getVertices(), self.getFaces(), nb::bytes(image.data(), image.size()));
+    })
+    .def("__setstate__", [](KDTree &self, const std::tuple<std::vector<Array3>, std::vector<IndexArray3>, nb::bytes> &state) {
+        const nb::bytes &image{std::get<2>(state)};
+        std::istringstream stream{std::string(image.c_str(), image.size()), std::ios::binary};
+        new (&self) KDTree(KDTree::load(stream, std::get<0>(state), std::get<1>(state)));
+    })
     .def("printTree", [](const KDTree & tree) {
         std::ostringstream os;
         os << tree;
@@ -43,4 +93,9 @@ NB_MODULE(KDTree_Python, m) {
         os << tree;
         return os.str();
     });
+    m.def("readPolyhedralSource", [](const std::vector<std::string> &fileNames) {
+        return TetgenAdapter{fileNames}.getPolyhedralSource();
+    }, "fileNames"_a, nb::call_guard<nb::gil_scoped_release>());
+    m.def("convertToBinaryMesh", &TetgenAdapter::convertToBinaryMesh, "fileNames"_a, "outputFilename"_a,
+          nb::call_guard<nb::gil_scoped_release>());
 }
\ No newline at end of file
@@ -136,6 +136,19 @@ namespace kdtree {
         state.SetComplexityN(static_cast<benchmark::ComplexityN>(faces.size()));
     }
 
+    void BM_Eros_Intersection_Batch(benchmark::State &state) {
+        using namespace kdtree::util;
+        const auto [vertices, faces, centroids] = erosMeshes[state.range(0)];
+        const std::vector<Array3> origins(centroids.size(), Array3{0, 0, 0});
+        KDTree tree{vertices, faces};
+        tree.prebuildTree();
+        for (auto _: state) {
+            benchmark::DoNotOptimize(tree.countIntersections(origins, centroids));
+            benchmark::ClobberMemory();
+        }
+        state.SetComplexityN(static_cast<benchmark::ComplexityN>(faces.size()));
+    }
+
     void BM_Eros_Intersection_Tree_Build(benchmark::State &state, const PlaneSelectionAlgorithm::Algorithm &algorithm) {
         using namespace kdtree::util;
         const auto [vertices, faces, centroids] = erosMeshes[state.range(0)];
@@ -167,14 +180,20 @@ namespace kdtree {
                       PlaneSelectionAlgorithm::Algorithm::LOGSQUARED)->DenseRange(0, erosMeshes.size() - 1, 1);
     BENCHMARK_CAPTURE(BM_Eros_Intersection_Tree, "ErosPolyhedronLog", PlaneSelectionAlgorithm::Algorithm::LOG)->DenseRange(
         0, erosMeshes.size() - 1, 1);
+    BENCHMARK_CAPTURE(BM_Eros_Intersection_Tree, "ErosPolyhedronBinned", PlaneSelectionAlgorithm::Algorithm::BINNED)->DenseRange(
+        0, erosMeshes.size() - 1, 1);
     BENCHMARK(BM_Eros_Intersection_Tree_Twice)->Name("ErosPolyhedronSecondRun")->DenseRange(
         0, erosMeshes.size() - 1, 1);
+    BENCHMARK(BM_Eros_Intersection_Batch)->Name("ErosPolyhedronBatch")->DenseRange(
+        0, erosMeshes.size() - 1, 1);
     BENCHMARK_CAPTURE(BM_Eros_Intersection_Tree_Build, "ErosPolyhedronBuildTreeSquared", PlaneSelectionAlgorithm::Algorithm::QUADRATIC)->DenseRange(
         0, erosMeshes.size() - 1, 1);
     BENCHMARK_CAPTURE(BM_Eros_Intersection_Tree_Build, "ErosPolyhedronBuildTreeLogSquared", PlaneSelectionAlgorithm::Algorithm::LOGSQUARED)->DenseRange(
         0, erosMeshes.size() - 1, 1);
     BENCHMARK_CAPTURE(BM_Eros_Intersection_Tree_Build, "ErosPolyhedronBuildTreeLog", PlaneSelectionAlgorithm::Algorithm::LOG)->DenseRange(
         0, erosMeshes.size() - 1, 1);
+    BENCHMARK_CAPTURE(BM_Eros_Intersection_Tree_Build, "ErosPolyhedronBuildTreeBinned", PlaneSelectionAlgorithm::Algorithm::BINNED)->DenseRange(
+        0, erosMeshes.size() - 1, 1);
 
     // sphere mesh benchmarks
     BENCHMARK_CAPTURE(BM_Sphere_Intersection_Tree, "SpherePolyhedronNoTree", PlaneSelectionAlgorithm::Algorithm::NOTREE)->DenseRange(
@@ -185,6 +204,8 @@ namespace kdtree {
                       PlaneSelectionAlgorithm::Algorithm::LOGSQUARED)->DenseRange(0, sphereMeshes.size() - 1, 1);
     BENCHMARK_CAPTURE(BM_Sphere_Intersection_Tree, "SpherePolyhedronLog", PlaneSelectionAlgorithm::Algorithm::LOG)->DenseRange(
         0, sphereMeshes.size() - 1, 1);
+    BENCHMARK_CAPTURE(BM_Sphere_Intersection_Tree, "SpherePolyhedronBinned", PlaneSelectionAlgorithm::Algorithm::BINNED)->DenseRange(
+        0, sphereMeshes.size() - 1, 1);
     BENCHMARK(BM_Sphere_Intersection_Tree_Twice)->Name("SpherePolyhedronSecondRun")->DenseRange(
         0, sphereMeshes.size() - 1, 1);
     BENCHMARK_CAPTURE(BM_Sphere_Intersection_Tree_Build, "SpherePolyhedronBuildTreeSquared", PlaneSelectionAlgorithm::Algorithm::QUADRATIC)->DenseRange(
@@ -193,6 +214,8 @@ namespace kdtree {
         0, sphereMeshes.size() - 1, 1);
     BENCHMARK_CAPTURE(BM_Sphere_Intersection_Tree_Build, "SpherePolyhedronBuildTreeLog", PlaneSelectionAlgorithm::Algorithm::LOG)->DenseRange(
         0, sphereMeshes.size() - 1, 1);
+    BENCHMARK_CAPTURE(BM_Sphere_Intersection_Tree_Build, "SpherePolyhedronBuildTreeBinned", PlaneSelectionAlgorithm::Algorithm::BINNED)->DenseRange(
+        0, sphereMeshes.size() - 1, 1);
 } // namespace polyhedralGravity
 
 BENCHMARK_MAIN();
\ No newline at end of file
@@ -1,6 +1,9 @@
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
 
+#include <filesystem>
+#include <random>
+#include <sstream>
 #include <string>
 #include <vector>
 #include "KDTree/input/TetgenAdapter.h"
@@ -35,6 +38,21 @@ protected:
             {4, 7, 6}
     };
 
+    /**
+     * A binary mesh file in the temp directory with a random name, so that concurrent test runs don't share it. Removed after each test, even if it failed.
+     */
+    const std::string _binaryFile{[] {
+        std::random_device device{};
+        std::ostringstream name{};
+        name << "TetgenAdapterTest-" << std::hex << device() << device() << ".kdmesh";
+        return std::filesystem::temp_directory_path().append(name.str()).string();
+    }()};
+
+    void TearDown() override {
+        std::error_code error{};
+        std::filesystem::remove(_binaryFile, error);
+    }
+
 };
 
 TEST_F(TetgenAdapterTest, readSimpleNode) {
@@ -126,4 +144,32 @@ TEST_F(TetgenAdapterTest, readSimpleStl) {
         ASSERT_THAT(_expectedVertices, Contains(actualVertice));
     }
     ASSERT_EQ(_expectedFaces.size(), actualFaces.size());
-}
\ No newline at end of file
+}
+
+TEST_F(TetgenAdapterTest, binaryMeshRoundTrip) {
+    using namespace testing;
+    using namespace ::kdtree;
+
+    TetgenAdapter::convertToBinaryMesh({"resources/TetgenAdapterTestReadSimple.node",
+                                        "resources/TetgenAdapterTestReadSimple.face"}, _binaryFile);
+
+    TetgenAdapter tetgenAdapter{{_binaryFile}};
+    const auto&[actualVertices, actualFaces] = tetgenAdapter.getPolyhedralSource();
+
+    ASSERT_THAT(actualVertices, ContainerEq(_expectedVertices));
+    ASSERT_THAT(actualFaces, ContainerEq(_expectedFaces));
+}
+
+TEST_F(TetgenAdapterTest, binaryMeshRejectsMalformedFiles) {
+    using namespace ::kdtree;
+
+    TetgenAdapter::writeBinaryMesh(_binaryFile, _expectedVertices, _expectedFaces);
+    //drop the last face index
+    std::filesystem::resize_file(_binaryFile, std::filesystem::file_size(_binaryFile) - sizeof(uint32_t));
+    EXPECT_THROW(TetgenAdapter{{_binaryFile}}.getPolyhedralSource(), std::runtime_error);
+
+    //a face referring to a missing vertex
+    std::vector<std::array<size_t, 3>> faces{_expectedFaces};
+    faces.back()[2] = _expectedVertices.size();
+    EXPECT_THROW(TetgenAdapter::writeBinaryMesh(_binaryFile, _expectedVertices, faces), std::invalid_argument);
+}
@@ -5,9 +5,16 @@
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <limits>
 #include <random>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -149,7 +156,618 @@ namespace kdtree {
         std::for_each(points.cbegin(), points.cend(), pointTest);
     }
 
-    TEST_P(KDTreeTest, AlgorithmRegressionTest) {
+    TEST_P(KDTreeTest, FrozenTreeTest) {
+        using namespace kdtree;
+        using namespace util;
+        const auto [vertices, faces, algorithm, points] = GetParam();
+        KDTree lazyTree{vertices, faces, algorithm};
+        KDTree frozenTree{vertices, faces, algorithm};
+        frozenTree.prebuildTree();
+        constexpr Array3 origin{200, 200, 200};
+        const auto pointTest = [&lazyTree, &frozenTree, &origin](const Array3 &point) {
+            const auto ray{(point - origin) / 10.0};
+            std::set<Array3> lazyIntersections;
+            std::set<Array3> frozenIntersections;
+            lazyTree.getFaceIntersections(origin, ray, lazyIntersections);
+            frozenTree.getFaceIntersections(origin, ray, frozenIntersections);
+            ASSERT_EQ(lazyIntersections, frozenIntersections);
+        };
+        std::for_each(points.cbegin(), points.cend(), pointTest);
+    }
+
+    TEST_P(KDTreeTest, ConcurrentQueryTest) {
+        using namespace kdtree;
+        using namespace util;
+        const auto [vertices, faces, algorithm, points] = GetParam();
+        KDTree referenceTree{vertices, faces, algorithm};
+        KDTree sharedTree{vertices, faces, algorithm};
+        constexpr Array3 origin{200, 200, 200};
+        constexpr size_t threadCount{4};
+        //all threads query the same points, so that they race to build the same nodes
+        std::vector<std::vector<std::set<Array3> > > results(threadCount, std::vector<std::set<Array3> >(points.size()));
+        std::vector<std::thread> threads{};
+        for (size_t t = 0; t < threadCount; ++t) {
+            threads.emplace_back([&sharedTree, &points, &origin, &result = results[t]] {
+                for (size_t i = 0; i < points.size(); ++i) {
+                    sharedTree.getFaceIntersections(origin, (points[i] - origin) / 10.0, result[i]);
+                }
+            });
+        }
+        std::for_each(threads.begin(), threads.end(), [](std::thread &thread) { thread.join(); });
+        for (size_t i = 0; i < points.size(); ++i) {
+            std::set<Array3> expectedIntersections;
+            referenceTree.getFaceIntersections(origin, (points[i] - origin) / 10.0, expectedIntersections);
+            for (const auto &result: results) {
+                ASSERT_EQ(result[i], expectedIntersections);
+            }
+        }
+    }
+
+    TEST_P(KDTreeTest, BackgroundBuildTest) {
+        using namespace kdtree;
+        using namespace util;
+        const auto [vertices, faces, algorithm, points] = GetParam();
+        KDTree referenceTree{vertices, faces, algorithm};
+        KDTree backgroundTree{vertices, faces, algorithm};
+        KDTree cancelledTree{vertices, faces, algorithm};
+        std::mutex progressLock{};
+        std::vector<BuildProgress> reports{};
+        //the queries run while the pool builds the tree
+        backgroundTree.buildInBackground(2, [&progressLock, &reports](const BuildProgress &progress) {
+            std::lock_guard lock{progressLock};
+            reports.push_back(progress);
+        });
+        cancelledTree.buildInBackground(2);
+        cancelledTree.cancelBackgroundBuild();
+        ASSERT_THROW(backgroundTree.setMemoryBudget(1), std::runtime_error);
+        constexpr Array3 origin{200, 200, 200};
+        for (const Array3 &point: points) {
+            std::set<Array3> expectedIntersections;
+            std::set<Array3> backgroundIntersections;
+            std::set<Array3> cancelledIntersections;
+            referenceTree.getFaceIntersections(origin, (point - origin) / 10.0, expectedIntersections);
+            backgroundTree.getFaceIntersections(origin, (point - origin) / 10.0, backgroundIntersections);
+            cancelledTree.getFaceIntersections(origin, (point - origin) / 10.0, cancelledIntersections);
+            ASSERT_EQ(backgroundIntersections, expectedIntersections);
+            ASSERT_EQ(cancelledIntersections, expectedIntersections);
+        }
+        backgroundTree.waitForBackgroundBuild();
+        cancelledTree.waitForBackgroundBuild();
+        //the reports are ordered and the last one announces the frozen tree
+        ASSERT_FALSE(reports.empty());
+        ASSERT_TRUE(reports.back().finished);
+        ASSERT_EQ(std::count_if(reports.cbegin(), reports.cend(), [](const BuildProgress &progress) { return progress.finished; }), 1);
+        ASSERT_TRUE(std::is_sorted(reports.cbegin(), reports.cend(), [](const BuildProgress &lhs, const BuildProgress &rhs) {
+            return lhs.builtNodes < rhs.builtNodes;
+        }));
+        ASSERT_EQ(reports.back().pendingNodes, 0);
+        for (const Array3 &point: points) {
+            std::set<Array3> expectedIntersections;
+            std::set<Array3> frozenIntersections;
+            referenceTree.getFaceIntersections(origin, (point - origin) / 10.0, expectedIntersections);
+            backgroundTree.getFaceIntersections(origin, (point - origin) / 10.0, frozenIntersections);
+            ASSERT_EQ(frozenIntersections, expectedIntersections);
+        }
+    }
+
+    TEST(KDTreeBackgroundBuildTest, ExcludesMemoryBudgetTest) {
+        using namespace kdtree;
+        //whichever call wins the race, the other one is rejected
+        for (size_t round = 0; round < 20; ++round) {
+            KDTree tree{bigVertices, bigFaces, Algorithm::LOG};
+            std::atomic_bool budgetRejected{false};
+            std::atomic_bool buildRejected{false};
+            std::thread budgetThread{[&tree, &budgetRejected] {
+                try {
+                    tree.setMemoryBudget(1);
+                } catch (const std::runtime_error &) {
+                    budgetRejected.store(true);
+                }
+            }};
+            try {
+                tree.buildInBackground(2);
+            } catch (const std::runtime_error &) {
+                buildRejected.store(true);
+            }
+            budgetThread.join();
+            ASSERT_NE(budgetRejected.load(), buildRejected.load());
+            tree.cancelBackgroundBuild();
+            tree.waitForBackgroundBuild();
+        }
+    }
+
+    TEST(SplitNodeTest, MarkPrioritizedTest) {
+        using namespace kdtree;
+        KDTree tree{bigVertices, bigFaces, Algorithm::LOG};
+        auto *root = dynamic_cast<SplitNode *>(tree.getRootNode());
+        ASSERT_NE(root, nullptr);
+        //only the first query reaching a node queues it in the background build
+        ASSERT_TRUE(root->markPrioritized());
+        ASSERT_FALSE(root->markPrioritized());
+        //the flag is kept per node
+        auto *child = dynamic_cast<SplitNode *>(root->getChildNode(0));
+        ASSERT_NE(child, nullptr);
+        ASSERT_TRUE(child->markPrioritized());
+    }
+
+    TEST_P(KDTreeTest, SerializationTest) {
+        using namespace kdtree;
+        using namespace util;
+        const auto [vertices, faces, algorithm, points] = GetParam();
+        KDTree builtTree{vertices, faces, algorithm};
+        const std::string path{std::filesystem::temp_directory_path().append("KDTreeSerializationTest.kdtree").string()};
+        builtTree.save(path);
+        std::stringstream stream{std::ios::in | std::ios::out | std::ios::binary};
+        builtTree.save(stream);
+        KDTree fileTree{KDTree::load(path, vertices, faces)};
+        KDTree streamTree{KDTree::load(stream, vertices, faces)};
+        constexpr Array3 origin{200, 200, 200};
+        for (const Array3 &point: points) {
+            std::set<Array3> expectedIntersections;
+            std::set<Array3> fileIntersections;
+            std::set<Array3> streamIntersections;
+            builtTree.getFaceIntersections(origin, (point - origin) / 10.0, expectedIntersections);
+            fileTree.getFaceIntersections(origin, (point - origin) / 10.0, fileIntersections);
+            streamTree.getFaceIntersections(origin, (point - origin) / 10.0, streamIntersections);
+            ASSERT_EQ(fileIntersections, expectedIntersections);
+            ASSERT_EQ(streamIntersections, expectedIntersections);
+            ASSERT_EQ(fileTree.isInside(point), builtTree.isInside(point));
+        }
+        //the loaded tree keeps nothing for a lazy build and refuses to build a different tree
+        ASSERT_EQ(fileTree.memoryUsage(), 0);
+        ASSERT_THROW(fileTree.getRootNode(), std::runtime_error);
+        std::ostringstream printed{};
+        printed << fileTree;
+        ASSERT_THAT(printed.str(), testing::StartsWith("KDTree loaded with "));
+        fileTree.buildInBackground(2).waitForBackgroundBuild();
+        //the file is keyed by the polyhedron
+        std::vector<Array3> movedVertices{vertices};
+        movedVertices[0][0] += 1.0;
+        ASSERT_THROW(KDTree::load(path, movedVertices, faces), std::invalid_argument);
+        //a truncated file is rejected instead of being read out of bounds
+        const std::string image{stream.str()};
+        std::stringstream truncated{image.substr(0, image.size() / 2), std::ios::in | std::ios::binary};
+        ASSERT_THROW(KDTree::load(truncated, vertices, faces), std::runtime_error);
+        std::remove(path.c_str());
+    }
+
+    TEST_P(KDTreeTest, MemoryBudgetTest) {
+        using namespace kdtree;
+        using namespace util;
+        const auto [vertices, faces, algorithm, points] = GetParam();
+        KDTree unboundedTree{vertices, faces, algorithm};
+        KDTree boundedTree{vertices, faces, algorithm};
+        constexpr Array3 origin{200, 200, 200};
+        //every query on the bounded tree rebuilds the evicted path -> a subset of the points suffices
+        constexpr size_t stride{10};
+        std::set<Array3> firstIntersections;
+        unboundedTree.getFaceIntersections(origin, (points[0] - origin) / 10.0, firstIntersections);
+        const size_t firstQueryUsage{unboundedTree.memoryUsage()};
+        //the smallest budget evicts every subtree below the root after each query, which must not change the results
+        boundedTree.setMemoryBudget(1);
+        for (size_t i = 0; i < points.size(); i += stride) {
+            std::set<Array3> expectedIntersections;
+            std::set<Array3> intersections;
+            unboundedTree.getFaceIntersections(origin, (points[i] - origin) / 10.0, expectedIntersections);
+            boundedTree.getFaceIntersections(origin, (points[i] - origin) / 10.0, intersections);
+            ASSERT_EQ(intersections, expectedIntersections);
+            ASSERT_LE(boundedTree.memoryUsage(), firstQueryUsage);
+        }
+    }
+
+    TEST_P(KDTreeTest, FirstHitTest) {
+        using namespace kdtree;
+        using namespace util;
+        const auto [vertices, faces, algorithm, points] = GetParam();
+        KDTree tree{vertices, faces, algorithm};
+        constexpr Array3 origin{200, 200, 200};
+        const auto pointTest = [&tree, &origin](const Array3 &point) {
+            const auto ray{(point - origin) / 10.0};
+            std::set<Array3> intersections;
+            tree.getFaceIntersections(origin, ray, intersections);
+            const auto expected = std::min_element(intersections.cbegin(), intersections.cend(),
+                                                   [&origin](const Array3 &lhs, const Array3 &rhs) {
+                                                       return euclideanNorm(lhs - origin) < euclideanNorm(rhs - origin);
+                                                   });
+            const auto closest = tree.closestIntersection(origin, ray);
+            ASSERT_TRUE(closest.has_value());
+            ASSERT_THAT(closest.value(), ElementsAre(DoubleNear((*expected)[0], DELTA), DoubleNear((*expected)[1], DELTA),
+                                                     DoubleNear((*expected)[2], DELTA)));
+            // the point lies at t = 10 on the ray, the closest hit cannot lie behind it
+            ASSERT_TRUE(tree.anyIntersection(origin, ray));
+            ASSERT_TRUE(tree.anyIntersection(origin, ray, 10.0 + DELTA));
+            ASSERT_FALSE(tree.anyIntersection(origin, ray * -1.0));
+        };
+        std::for_each(points.cbegin(), points.cend(), pointTest);
+    }
+
+    TEST_P(KDTreeTest, BatchCountTest) {
+        using namespace kdtree;
+        using namespace util;
+        const auto [vertices, faces, algorithm, points] = GetParam();
+        KDTree tree{vertices, faces, algorithm};
+        constexpr Array3 origin{200, 200, 200};
+        std::vector<Array3> origins{};
+        std::vector<Array3> rays{};
+        std::for_each(points.cbegin(), points.cend(), [&origins, &rays, &origin](const Array3 &point) {
+            origins.push_back(origin);
+            rays.push_back((point - origin) / 10.0);
+            // second ray starting on the surface of the polyhedron
+            origins.push_back(point);
+            rays.push_back(point - origin);
+        });
+        const auto counts = tree.countIntersections(origins, rays);
+        ASSERT_EQ(counts.size(), origins.size());
+        for (size_t i = 0; i < counts.size(); ++i) {
+            ASSERT_EQ(counts[i], tree.countIntersections(origins[i], rays[i])) << "Mismatch for ray " << i;
+        }
+        ASSERT_THROW(tree.countIntersections(origins, {}), std::invalid_argument);
+    }
+
+    TEST_P(KDTreeTest, QueryContextTest) {
+        using namespace kdtree;
+        using namespace util;
+        const auto [vertices, faces, algorithm, points] = GetParam();
+        KDTree lazyTree{vertices, faces, algorithm};
+        KDTree frozenTree{vertices, faces, algorithm};
+        frozenTree.prebuildTree();
+        constexpr Array3 origin{200, 200, 200};
+        // one context reused for all queries of both trees
+        QueryContext context{};
+        std::for_each(points.cbegin(), points.cend(), [&lazyTree, &frozenTree, &origin, &context](const Array3 &point) {
+            const Array3 ray{point - origin};
+            std::set<Array3> expected{};
+            lazyTree.getFaceIntersections(origin, ray, expected);
+            ASSERT_EQ(lazyTree.countIntersections(origin, ray, context), expected.size());
+            ASSERT_THAT(context.intersections, ContainerEq(std::vector<Array3>{expected.cbegin(), expected.cend()}));
+            ASSERT_EQ(frozenTree.countIntersections(origin, ray, context), expected.size());
+            ASSERT_EQ(frozenTree.countCrossings(origin, ray, context), frozenTree.countCrossings(origin, ray));
+        });
+    }
+
+    TEST_P(KDTreeTest, PacketTraversalTest) {
+        using namespace kdtree;
+        using namespace util;
+        const auto [vertices, faces, algorithm, points] = GetParam();
+        KDTree tree{vertices, faces, algorithm};
+        const FlatTree flatTree{tree.getRootNode(), Box::getBoundingBox(vertices), vertices, faces};
+        constexpr Array3 origin{200, 200, 200};
+        // coherent rays from a shared origin, rays parallel to an axis and rays pointing into different octants
+        std::vector<std::pair<Array3, Array3> > testRays{};
+        std::for_each(points.cbegin(), points.cend(), [&testRays, &origin](const Array3 &point) {
+            testRays.emplace_back(origin, point - origin);
+            testRays.emplace_back(point, Array3{1.0, 0.0, 0.0});
+            testRays.emplace_back(Array3{0.0, 0.0, 0.0}, point);
+        });
+        for (size_t first = 0; first + PACKET_SIZE <= testRays.size(); first += PACKET_SIZE) {
+            std::array<Array3, PACKET_SIZE> origins{};
+            std::array<Array3, PACKET_SIZE> rays{};
+            for (size_t lane = 0; lane < PACKET_SIZE; ++lane) {
+                std::tie(origins[lane], rays[lane]) = testRays[first + lane];
+            }
+            std::array<std::vector<Array3>, PACKET_SIZE> intersections{};
+            flatTree.getFaceIntersections(origins, rays, intersections);
+            for (size_t lane = 0; lane < PACKET_SIZE; ++lane) {
+                std::vector<Array3> expected{};
+                flatTree.getFaceIntersections(origins[lane], rays[lane], expected);
+                QueryContext::removeDuplicates(intersections[lane]);
+                QueryContext::removeDuplicates(expected);
+                ASSERT_EQ(intersections[lane].size(), expected.size()) << "Mismatch for ray " << first + lane;
+                auto packetIntersection = intersections[lane].cbegin();
+                for (const Array3 &intersection: expected) {
+                    ASSERT_THAT(*packetIntersection++, ::testing::Pointwise(::testing::DoubleNear(1e-9), intersection));
+                }
+            }
+        }
+    }
+
+    TEST_P(KDTreeTest, WatertightTest) {
+        using namespace kdtree;
+        using namespace util;
+        const auto [vertices, faces, algorithm, points] = GetParam();
+        KDTree tree{vertices, faces, algorithm};
+        constexpr Array3 origin{200, 200, 200};
+        ASSERT_FALSE(tree.isInside(origin));
+        std::for_each(points.cbegin(), points.cend(), [&tree, &origin](const Array3 &point) {
+            const Array3 ray{(point - origin) / 10.0};
+            std::set<Array3> intersections{};
+            tree.getFaceIntersections(origin, ray, intersections);
+            ASSERT_EQ(tree.countCrossings(origin, ray), intersections.size());
+            // the ray enters the polyhedron at its first intersection and leaves it at the second one
+            std::vector<Array3> sortedIntersections{intersections.cbegin(), intersections.cend()};
+            std::sort(sortedIntersections.begin(), sortedIntersections.end(), [&origin](const Array3 &lhs, const Array3 &rhs) {
+                return euclideanNorm(lhs - origin) < euclideanNorm(rhs - origin);
+            });
+            ASSERT_GE(sortedIntersections.size(), 2);
+            ASSERT_TRUE(tree.isInside((sortedIntersections[0] + sortedIntersections[1]) / 2.0));
+        });
+    }
+
+    TEST_P(KDTreeTest, BuildOptionsTest) {
+        using namespace kdtree;
+        using namespace util;
+        const auto [vertices, faces, algorithm, points] = GetParam();
+        const BuildOptions tunedOptions{BuildOptions::autoTune(vertices, faces)};
+        ASSERT_NO_THROW(tunedOptions.validate());
+        ASSERT_GT(tunedOptions.traverseStepCost, 0.0);
+        BuildOptions shallowOptions{};
+        shallowOptions.maxDepth = 8;
+        shallowOptions.minLeafSize = 4;
+        shallowOptions.emptySpaceBonus = 0.5;
+        KDTree defaultTree{vertices, faces, algorithm};
+        KDTree tunedTree{vertices, faces, algorithm, tunedOptions};
+        KDTree shallowTree{vertices, faces, algorithm, shallowOptions};
+        constexpr Array3 origin{200, 200, 200};
+        //the options change the shape of the tree, but not the results
+        std::for_each(points.cbegin(), points.cend(), [&](const Array3 &point) {
+            const auto ray{(point - origin) / 10.0};
+            std::set<Array3> expectedIntersections;
+            std::set<Array3> tunedIntersections;
+            std::set<Array3> shallowIntersections;
+            defaultTree.getFaceIntersections(origin, ray, expectedIntersections);
+            tunedTree.getFaceIntersections(origin, ray, tunedIntersections);
+            shallowTree.getFaceIntersections(origin, ray, shallowIntersections);
+            ASSERT_EQ(tunedIntersections, expectedIntersections);
+            ASSERT_EQ(shallowIntersections, expectedIntersections);
+        });
+    }
+
+    TEST_P(KDTreeTest, EmptySpaceTest) {
+        using namespace kdtree;
+        using namespace util;
+        const auto [vertices, faces, algorithm, points] = GetParam();
+        BuildOptions options{};
+        options.scaleEmptySpaceBonus = true;
+        options.emptyCutoffThreshold = 0.1;
+        options.tightBounds = true;
+        KDTree defaultTree{vertices, faces, algorithm};
+        KDTree lazyTree{vertices, faces, algorithm, options};
+        KDTree frozenTree{vertices, faces, algorithm, options};
+        frozenTree.prebuildTree();
+        constexpr Array3 origin{200, 200, 200};
+        //cutting off empty space and culling rays by the tight bounds must not lose any intersection
+        std::for_each(points.cbegin(), points.cend(), [&](const Array3 &point) {
+            const auto ray{(point - origin) / 10.0};
+            std::set<Array3> expectedIntersections;
+            std::set<Array3> lazyIntersections;
+            std::set<Array3> frozenIntersections;
+            defaultTree.getFaceIntersections(origin, ray, expectedIntersections);
+            lazyTree.getFaceIntersections(origin, ray, lazyIntersections);
+            frozenTree.getFaceIntersections(origin, ray, frozenIntersections);
+            ASSERT_EQ(lazyIntersections, expectedIntersections);
+            ASSERT_EQ(frozenIntersections, expectedIntersections);
+        });
+    }
+
+    TEST(KDTreeEmptySpaceTest, AxisAlignedFacesTest) {
+        using namespace kdtree;
+        BuildOptions options{};
+        options.scaleEmptySpaceBonus = true;
+        options.emptyCutoffThreshold = 0.1;
+        options.tightBounds = true;
+        std::mt19937 gen{4142561877}; // NOLINT(*-msc51-cpp), predictable sequence wanted
+        std::uniform_real_distribution<> cluster(15, 16);
+        std::uniform_real_distribution<> center(-1, 1);
+        std::uniform_real_distribution<> corner(9, 10);
+        std::uniform_real_distribution<> square(-7.5, 7.5);
+        std::uniform_real_distribution<> tilt(-0.1, 0.1);
+        //the mesh is built with the square normal to x and rotated, so that the square lies in a plane of each axis
+        for (size_t axis = 0; axis < DIMENSIONS; ++axis) {
+            const auto rotate = [axis](const Array3 &point) {
+                return Array3{point[(3 - axis) % 3], point[(4 - axis) % 3], point[(5 - axis) % 3]};
+            };
+            //a large square, a few faces near one of its corners and a cluster of faces behind it. Faces lying in a plane only have events on their first planar axis,
+            //the other axes of the square's node only have the events of the corner faces
+            std::vector<Array3> vertices{rotate({0, -10, -10}), rotate({0, 10, -10}), rotate({0, 10, 10}), rotate({0, -10, 10})};
+            std::vector<IndexArray3> faces{{0, 1, 2}, {0, 2, 3}};
+            for (size_t i = 0; i < 50; ++i) {
+                const size_t first{vertices.size()};
+                for (size_t vertex = 0; vertex < 3; ++vertex) {
+                    vertices.push_back(rotate({cluster(gen), center(gen), center(gen)}));
+                }
+                faces.push_back({first, first + 1, first + 2});
+            }
+            for (size_t i = 0; i < 5; ++i) {
+                const size_t first{vertices.size()};
+                for (size_t vertex = 0; vertex < 3; ++vertex) {
+                    vertices.push_back(rotate({corner(gen) - 8, corner(gen), corner(gen)}));
+                }
+                faces.push_back({first, first + 1, first + 2});
+            }
+            for (const Algorithm algorithm: {Algorithm::NOTREE, Algorithm::QUADRATIC, Algorithm::LOGSQUARED, Algorithm::LOG, Algorithm::BINNED}) {
+                SCOPED_TRACE("axis " + std::to_string(axis) + ", algorithm " + std::to_string(static_cast<int>(algorithm)));
+                KDTree lazyTree{vertices, faces, algorithm, options};
+                KDTree frozenTree{vertices, faces, algorithm, options};
+                frozenTree.prebuildTree();
+                for (size_t i = 0; i < 200; ++i) {
+                    //rays towards the square
+                    const Array3 origin{rotate({-20, square(gen), square(gen)})};
+                    const Array3 ray{rotate({1, tilt(gen), tilt(gen)})};
+                    std::set<Array3> expectedIntersections;
+                    for (const IndexArray3 &face: faces) {
+                        const auto intersection{LeafNode::rayIntersectsTriangle(
+                            origin, ray, {vertices[face[0]], vertices[face[1]], vertices[face[2]]})};
+                        if (intersection.has_value()) {
+                            expectedIntersections.insert(intersection.value());
+                        }
+                    }
+                    ASSERT_FALSE(expectedIntersections.empty()) << "FATAL: test logic faulty";
+                    std::set<Array3> lazyIntersections;
+                    std::set<Array3> frozenIntersections;
+                    lazyTree.getFaceIntersections(origin, ray, lazyIntersections);
+                    frozenTree.getFaceIntersections(origin, ray, frozenIntersections);
+                    ASSERT_EQ(lazyIntersections, expectedIntersections);
+                    ASSERT_EQ(frozenIntersections, expectedIntersections);
+                }
+            }
+        }
+    }
+
+    TEST(BuildOptionsTest, ValidationTest) {
+        using namespace kdtree;
+        const auto expectInvalid = [](const auto &modify) {
+            BuildOptions options{};
+            modify(options);
+            EXPECT_THROW(KDTree(KDTreeTest::cube_vertices, KDTreeTest::cube_faces, Algorithm::LOG, options),
+                         std::invalid_argument);
+        };
+        expectInvalid([](BuildOptions &options) { options.traverseStepCost = -1.0; });
+        expectInvalid([](BuildOptions &options) { options.triangleIntersectionCost = 0.0; });
+        expectInvalid([](BuildOptions &options) {
+            options.triangleIntersectionCost = std::numeric_limits<double>::infinity();
+        });
+        expectInvalid([](BuildOptions &options) { options.maxDepth = MAX_RECURSION_DEPTH + 1; });
+        expectInvalid([](BuildOptions &options) { options.emptySpaceBonus = 1.0; });
+        expectInvalid([](BuildOptions &options) { options.emptyCutoffThreshold = 1.5; });
+        EXPECT_NO_THROW(BuildOptions{}.validate());
+    }
+
+    TEST(KDTreeWatertightTest, SharedEdgesAndVerticesTest) {
+        using namespace kdtree;
+        KDTree tree{KDTreeTest::cube_vertices, KDTreeTest::cube_faces};
+        // passes the diagonal edges shared by the two faces of the bottom and the top side
+        ASSERT_EQ(tree.countCrossings({0, 0, -5}, {0, 0, 1}), 2);
+        // passes the opposite corners shared by several faces
+        ASSERT_EQ(tree.countCrossings({-2, -2, -2}, {1, 1, 1}), 2);
+        // enters through the diagonal edge of the bottom side and leaves through the edge between two lateral sides
+        ASSERT_EQ(tree.countCrossings({-2, -2, -2}, {1, 1, 0.5}), 2);
+        // touches the edge between the bottom and the front side from outside
+        ASSERT_EQ(tree.countCrossings({0, -2, 0}, {0, 1, -1}) % 2, 0);
+        ASSERT_TRUE(tree.isInside({0, 0, 0}));
+        ASSERT_TRUE(tree.isInside({0.5, -0.5, 0.999}));
+        ASSERT_FALSE(tree.isInside({0, 0, 1.5}));
+        ASSERT_FALSE(tree.isInside({-3, 0, 0}));
+    }
+
+    TEST(PlaneEventTest, KeyOrderTest) {
+        const std::vector<double> coordinates{
+            -std::numeric_limits<double>::infinity(), -1e300, -2.5, -1.0, -1e-300, 0.0, 1e-300, 0.75, 1.0, 3.0, 1e300,
+            std::numeric_limits<double>::infinity()
+        };
+        for (size_t i = 0; i < coordinates.size(); ++i) {
+            ASSERT_EQ(PlaneEvent::fromKey(PlaneEvent::toKey(coordinates[i])), coordinates[i]);
+            if (i > 0) {
+                ASSERT_LT(PlaneEvent::toKey(coordinates[i - 1]), PlaneEvent::toKey(coordinates[i])) << coordinates[i];
+            }
+        }
+        ASSERT_EQ(PlaneEvent::toKey(-0.0), PlaneEvent::toKey(0.0));
+        //events are ordered by orientation, then by coordinate and then by PlaneEventType
+        const PlaneEvent event{PlaneEventType::starting, {1.0, Direction::Y}, 42};
+        ASSERT_EQ(event.type(), PlaneEventType::starting);
+        ASSERT_EQ(event.plane(), Plane(1.0, Direction::Y));
+        ASSERT_EQ(event.faceIndex, 42);
+        ASSERT_LT(PlaneEvent(PlaneEventType::ending, {1.0, Direction::Y}, 0), event);
+        ASSERT_LT(event, PlaneEvent(PlaneEventType::ending, {1.5, Direction::Y}, 0));
+        ASSERT_LT(event, PlaneEvent(PlaneEventType::ending, {-1.0, Direction::Z}, 0));
+        ASSERT_LT(PlaneEvent(PlaneEventType::starting, {1.5, Direction::X}, 0), event);
+    }
+
+    TEST(BoxTest, ClipToVoxelBoundsTest) {
+        const Box box{std::make_pair(Array3{-1, -1, -1}, Array3{1, 1, 1})};
+        const std::vector<Array3Triplet> triangles{
+            {{{-0.5, -0.5, 0}, {0.5, -0.5, 0}, {0, 0.5, 0.5}}}, // inside
+            {{{-2, -2, 0}, {2, -2, 0}, {0, 2, 0}}}, // overlapping
+            {{{-3, 0, 0}, {3, 0.5, 0.25}, {0, 0.5, 3}}}, // overlapping
+            {{{1, -2, -2}, {1, 2, -2}, {1, 0, 2}}}, // touching
+            {{{2, 0, 0}, {3, 0, 0}, {2, 1, 0}}}, // outside
+            {{{0.9, 0.9, -2}, {3, 0.9, 0}, {0.9, 3, 0}}} // outside, overlapping the bounding box
+        };
+        for (const auto &triangle: triangles) {
+            const std::vector<Array3> clipped{box.clipToVoxel(triangle)};
+            const std::optional<Box> clippedBox{box.clipToVoxelBounds(triangle)};
+            ASSERT_EQ(clipped.empty(), !clippedBox.has_value());
+            if (!clipped.empty()) {
+                const Box expected{Box::getBoundingBox(clipped)};
+                ASSERT_EQ(clippedBox->minPoint, expected.minPoint);
+                ASSERT_EQ(clippedBox->maxPoint, expected.maxPoint);
+            }
+        }
+        ASSERT_FALSE(box.clipToVoxelBounds(triangles[4]).has_value());
+        ASSERT_EQ(box.clipToVoxelBounds(triangles[0])->maxPoint, Box::getBoundingBox(triangles[0]).maxPoint);
+    }
+
+    TEST(BoxTest, ClipCoplanarFacesTest) {
+        using namespace kdtree;
+        constexpr double top{6.6238321674430845};
+        const Box box{std::make_pair(Array3{-1, -1, -1}, Array3{1, 1, top})};
+        //lies in the top plane of the box, rounding the interpolated vertices makes the clipped polygon cross the plane repeatedly and grow to 10 vertices
+        const Array3Triplet coplanar{{
+            {1.4364951811241844, 0.16331463676291794, top}, {-1.0095852498790274, 1.0348563664589931, top},
+            {-0.5098858498410882, -1.3528512468508276, top}
+        }};
+        std::vector<Array3Triplet> triangles{coplanar};
+        //near coplanar faces, shifted by a few ulps
+        std::mt19937 gen{4142561877}; // NOLINT(*-msc51-cpp), predictable sequence wanted
+        std::uniform_int_distribution<> ulps(-4, 4);
+        for (size_t i = 0; i < 1000; ++i) {
+            Array3Triplet triangle{coplanar};
+            for (Array3 &vertex: triangle) {
+                for (int shift = ulps(gen); shift != 0; shift -= shift > 0 ? 1 : -1) {
+                    vertex[2] = std::nextafter(vertex[2], shift > 0 ? top + 1 : top - 1);
+                }
+            }
+            triangles.push_back(triangle);
+        }
+        for (const auto &triangle: triangles) {
+            const std::vector<Array3> clipped{box.clipToVoxel(triangle)};
+            const std::optional<Box> clippedBox{box.clipToVoxelBounds(triangle)};
+            ASSERT_EQ(clipped.empty(), !clippedBox.has_value());
+            if (clipped.empty()) {
+                continue;
+            }
+            const Box expected{Box::getBoundingBox(clipped)};
+            ASSERT_EQ(clippedBox->minPoint, expected.minPoint);
+            ASSERT_EQ(clippedBox->maxPoint, expected.maxPoint);
+            for (size_t axis = 0; axis < DIMENSIONS; ++axis) {
+                ASSERT_GE(clippedBox->minPoint[axis], box.minPoint[axis] - 1e-12);
+                ASSERT_LE(clippedBox->maxPoint[axis], box.maxPoint[axis] + 1e-12);
+            }
+        }
+    }
+
+    TEST(KDTreeBinnedTest, BruteForceTest) {
+        using namespace kdtree;
+        using namespace util;
+        KDTree lazyTree{bigVertices, bigFaces, Algorithm::BINNED};
+        KDTree frozenTree{bigVertices, bigFaces, Algorithm::BINNED};
+        frozenTree.prebuildTree();
+        std::mt19937 gen{4142561877}; // NOLINT(*-msc51-cpp), predictable sequence wanted
+        std::uniform_real_distribution<> distrib(-1, 1);
+        const Box box{Box::getBoundingBox(bigVertices)};
+        //the binned algorithm only approximates the optimal planes, but has to find exactly the faces hit by brute force
+        for (size_t i = 0; i < 200; ++i) {
+            Array3 origin{};
+            Array3 ray{};
+            for (size_t axis = 0; axis < DIMENSIONS; ++axis) {
+                const double extent{box.maxPoint[axis] - box.minPoint[axis]};
+                origin[axis] = box.minPoint[axis] + extent * (distrib(gen) + 1) / 2;
+                ray[axis] = distrib(gen);
+            }
+            std::set<Array3> expectedIntersections;
+            for (const IndexArray3 &face: bigFaces) {
+                const auto intersection{LeafNode::rayIntersectsTriangle(
+                    origin, ray, {bigVertices[face[0]], bigVertices[face[1]], bigVertices[face[2]]})};
+                if (intersection.has_value()) {
+                    expectedIntersections.insert(intersection.value());
+                }
+            }
+            std::set<Array3> lazyIntersections;
+            std::set<Array3> frozenIntersections;
+            lazyTree.getFaceIntersections(origin, ray, lazyIntersections);
+            frozenTree.getFaceIntersections(origin, ray, frozenIntersections);
+            ASSERT_EQ(lazyIntersections, expectedIntersections);
+            ASSERT_EQ(frozenIntersections, expectedIntersections);
+        }
+    }
+
+    /**
+     * Compares the planes of the plane event algorithms against the optimal planes of the quadratic algorithm. Not instantiated for the binned algorithm,
+     * which only approximates the optimal planes.
+     */
+    class KDTreeRegressionTest : public KDTreeTest {
+    };
+
+    TEST_P(KDTreeRegressionTest, AlgorithmRegressionTest) {
         using namespace kdtree;
         using namespace util;
         std::vector<Array3> vertices;
@@ -159,15 +777,20 @@ namespace kdtree {
         KDTree tree{vertices, faces, algorithm};
         auto squaredAlgorithm = PlaneSelectionAlgorithmFactory::create(Algorithm::QUADRATIC);
         auto variantAlgorithm = PlaneSelectionAlgorithmFactory::create(algorithm);
-        std::deque<std::shared_ptr<TreeNode> > nodePtrQueue{};
+        constexpr size_t checkedNodeId{109};
+        // a SplitNode releases its faces once it has distributed them to its children -> capture the parameters of the
+        // checked node from its parent before the node is built
+        std::optional<SplitParam> checkedParam{};
+        std::deque<TreeNode *> nodePtrQueue{};
         nodePtrQueue.push_back(tree.getRootNode());
         while (!nodePtrQueue.empty()) {
-            if (auto splitNodePtr = std::dynamic_pointer_cast<SplitNode>(nodePtrQueue.front())) {
-                SplitParam param = *splitNodePtr->_splitParam;
-                // The squared algorithm obtains plane orientations by round robin but the plane event algorithms evaluate
-                // all orientations and the choose the best one -> squared algorithm needs to know the desired orientation
-                param.splitDirection = splitNodePtr->_plane.orientation;
-                if (splitNodePtr->nodeId == 109) {
+            if (auto *splitNodePtr = dynamic_cast<SplitNode *>(nodePtrQueue.front())) {
+                if (splitNodePtr->nodeId == checkedNodeId) {
+                    ASSERT_TRUE(checkedParam.has_value()) << "FATAL: test logic faulty";
+                    SplitParam &param = checkedParam.value();
+                    // The squared algorithm obtains plane orientations by round robin but the plane event algorithms evaluate
+                    // all orientations and the choose the best one -> squared algorithm needs to know the desired orientation
+                    param.splitDirection = splitNodePtr->_plane.orientation;
                     const auto [optimalPlane, optimalCost, optimalTriangles] = squaredAlgorithm->findPlane(
                         holdsFaceIndices(param));
                     const auto [variantPlane, variantCost, variantTriangles] = variantAlgorithm->findPlane(param);
@@ -190,8 +813,16 @@ nodeId
 nodeId
                     << std::endl << "Plane: " << optimalPlane;
                 }
-                nodePtrQueue.push_back(splitNodePtr->getChildNode(0));
-                nodePtrQueue.push_back(splitNodePtr->getChildNode(1));
+                for (size_t index = 0; index < 2; ++index) {
+                    if (2 * splitNodePtr->nodeId + 1 + index == checkedNodeId) {
+                        const auto [lesserBox, greaterBox] = splitNodePtr->_boundingBox.splitBox(splitNodePtr->_plane);
+                        std::variant<TriangleIndexVector, PlaneEventVector> childFaces{splitNodePtr->_childFaces[index]};
+                        checkedParam.emplace(*splitNodePtr->_splitParam, std::move(childFaces),
+                                             splitNodePtr->_childFaceCounts[index], index == 0 ? lesserBox : greaterBox,
+                                             splitNodePtr->_plane.orientation);
+                    }
+                    nodePtrQueue.push_back(splitNodePtr->getChildNode(index));
+                }
             }
             nodePtrQueue.pop_front();
         }
@@ -212,6 +843,9 @@ nodeId
     INSTANTIATE_TEST_SUITE_P(LogPointsBig, KDTreeTest,
                              ::testing::Values(KDTreeTest::generateRandomPointsOnPolyhedron(bigVertices
                                  , bigFaces, Algorithm::LOG, numberOfPoints)));
+    INSTANTIATE_TEST_SUITE_P(BinnedPointsBig, KDTreeTest,
+                             ::testing::Values(KDTreeTest::generateRandomPointsOnPolyhedron(bigVertices
+                                 , bigFaces, Algorithm::BINNED, numberOfPoints)));
 
     INSTANTIATE_TEST_SUITE_P(NoTreePointsCube, KDTreeTest,
                              ::testing::Values(KDTreeTest::generateRandomPointsOnPolyhedron(KDTreeTest::cube_vertices,
@@ -225,6 +859,9 @@ nodeId
     INSTANTIATE_TEST_SUITE_P(LogPointsCube, KDTreeTest,
                              ::testing::Values(KDTreeTest::generateRandomPointsOnPolyhedron(KDTreeTest::cube_vertices,
                                  KDTreeTest::cube_faces, Algorithm::LOG, numberOfPoints)));
+    INSTANTIATE_TEST_SUITE_P(BinnedPointsCube, KDTreeTest,
+                             ::testing::Values(KDTreeTest::generateRandomPointsOnPolyhedron(KDTreeTest::cube_vertices,
+                                 KDTreeTest::cube_faces, Algorithm::BINNED, numberOfPoints)));
 
     INSTANTIATE_TEST_SUITE_P(NoTreeGreatNumberOfPointsBig, KDTreeTest,
                              ::testing::Values(KDTreeTest::generateRandomPointsOnPolyhedron(bigVertices
@@ -235,4 +872,30 @@ nodeId
     INSTANTIATE_TEST_SUITE_P(LogGreatNumberOfPointsBig, KDTreeTest,
                              ::testing::Values(KDTreeTest::generateRandomPointsOnPolyhedron(bigVertices
                                  , bigFaces, Algorithm::LOG, bigNumberOfPoints)));
+    INSTANTIATE_TEST_SUITE_P(BinnedGreatNumberOfPointsBig, KDTreeTest,
+                             ::testing::Values(KDTreeTest::generateRandomPointsOnPolyhedron(bigVertices
+                                 , bigFaces, Algorithm::BINNED, bigNumberOfPoints)));
+
+    INSTANTIATE_TEST_SUITE_P(NoTreeRegressionBig, KDTreeRegressionTest,
+                             ::testing::Values(KDTreeTest::generateRandomPointsOnPolyhedron(bigVertices
+                                 , bigFaces, Algorithm::NOTREE, numberOfPoints)));
+    INSTANTIATE_TEST_SUITE_P(QuadraticRegressionBig, KDTreeRegressionTest,
+                             ::testing::Values(KDTreeTest::generateRandomPointsOnPolyhedron(bigVertices
+                                 , bigFaces, Algorithm::QUADRATIC, numberOfPoints)));
+    INSTANTIATE_TEST_SUITE_P(LogSquaredRegressionBig, KDTreeRegressionTest,
+                             ::testing::Values(KDTreeTest::generateRandomPointsOnPolyhedron(bigVertices
+                                 , bigFaces, Algorithm::LOGSQUARED, numberOfPoints)));
+    INSTANTIATE_TEST_SUITE_P(LogRegressionBig, KDTreeRegressionTest,
+                             ::testing::Values(KDTreeTest::generateRandomPointsOnPolyhedron(bigVertices
+                                 , bigFaces, Algorithm::LOG, numberOfPoints)));
+
+    INSTANTIATE_TEST_SUITE_P(QuadraticRegressionCube, KDTreeRegressionTest,
+                             ::testing::Values(KDTreeTest::generateRandomPointsOnPolyhedron(KDTreeTest::cube_vertices,
+                                 KDTreeTest::cube_faces, Algorithm::QUADRATIC, numberOfPoints)));
+    INSTANTIATE_TEST_SUITE_P(LogSquaredRegressionCube, KDTreeRegressionTest,
+                             ::testing::Values(KDTreeTest::generateRandomPointsOnPolyhedron(KDTreeTest::cube_vertices,
+                                 KDTreeTest::cube_faces, Algorithm::LOGSQUARED, numberOfPoints)));
+    INSTANTIATE_TEST_SUITE_P(LogRegressionCube, KDTreeRegressionTest,
+                             ::testing::Values(KDTreeTest::generateRandomPointsOnPolyhedron(KDTreeTest::cube_vertices,
+                                 KDTreeTest::cube_faces, Algorithm::LOG, numberOfPoints)));
 } // namespace kdtree
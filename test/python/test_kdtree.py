@@ -0,0 +1,82 @@
+from typing import List, Tuple
+from KDTree_Python import KDTree, PlaneSelectionAlgorithm
+import pickle
+import pytest
+from pathlib import Path
+
+CUBE_VERTICES = [
+    [-1.0, -1.0, -1.0],
+    [1.0, -1.0, -1.0],
+    [1.0, 1.0, -1.0],
+    [-1.0, 1.0, -1.0],
+    [-1.0, -1.0, 1.0],
+    [1.0, -1.0, 1.0],
+    [1.0, 1.0, 1.0],
+    [-1.0, 1.0, 1.0]
+]
+
+CUBE_FACES = [
+    [1, 3, 2],
+    [0, 3, 1],
+    [0, 1, 5],
+    [0, 5, 4],
+    [0, 7, 3],
+    [0, 4, 7],
+    [1, 2, 6],
+    [1, 6, 5],
+    [2, 3, 6],
+    [3, 7, 6],
+    [4, 5, 6],
+    [4, 6, 7]
+]
+
+RAYS = [
+    ([0.0, 0.0, 0.0], [1.0, 0.0, 0.0]),
+    ([0.1, 0.2, 0.3], [0.3, -0.5, 0.7]),
+    ([-5.0, 0.25, -0.5], [1.0, 0.0, 0.0]),
+    ([0.5, 0.5, 5.0], [0.0, 0.0, -1.0]),
+    ([5.0, 5.0, 5.0], [1.0, 1.0, 1.0]),
+    ([3.0, 0.0, 0.0], [0.0, 1.0, 0.0]),
+]
+
+ALGORITHMS = [
+    PlaneSelectionAlgorithm.NOTREE,
+    PlaneSelectionAlgorithm.QUADRATIC,
+    PlaneSelectionAlgorithm.LOGSQUARED,
+    PlaneSelectionAlgorithm.LOG,
+    PlaneSelectionAlgorithm.BINNED,
+]
+
+
+def query(tree: KDTree) -> List[Tuple]:
+    return [
+        (tree.countIntersections(origin, ray), tree.getFaceIntersections(origin, ray), tree.closestIntersection(origin, ray))
+        for origin, ray in RAYS
+    ]
+
+
+@pytest.mark.parametrize("algorithm", ALGORITHMS, ids=["NoTree", "Quadratic", "LogSquared", "Log", "Binned"])
+def test_save_load(algorithm: PlaneSelectionAlgorithm, tmp_path: Path) -> None:
+    tree = KDTree(CUBE_VERTICES, CUBE_FACES, algorithm)
+    expected = query(tree)
+    path = tmp_path / "cube.kdtree"
+
+    tree.save(str(path))
+    loaded = KDTree.load(str(path), CUBE_VERTICES, CUBE_FACES)
+    assert query(loaded) == expected
+
+    # The file is keyed by the polyhedron, a different one is rejected
+    moved_vertices = [[x + 1.0, y, z] for x, y, z in CUBE_VERTICES]
+    with pytest.raises(ValueError):
+        KDTree.load(str(path), moved_vertices, CUBE_FACES)
+
+
+@pytest.mark.parametrize("algorithm", ALGORITHMS, ids=["NoTree", "Quadratic", "LogSquared", "Log", "Binned"])
+def test_pickle(algorithm: PlaneSelectionAlgorithm) -> None:
+    tree = KDTree(CUBE_VERTICES, CUBE_FACES, algorithm)
+    expected = query(tree)
+
+    restored = pickle.loads(pickle.dumps(tree))
+    assert query(restored) == expected
+    # The restored tree carries its polyhedron and can be pickled again
+    assert query(pickle.loads(pickle.dumps(restored))) == expected